@@ -0,0 +1,104 @@
+#include "audio.h"
+#include <string.h>
+
+/* Audio output stage between the emulation loop and the sound device.
+ *
+ * After every frame the producer resamples the TIA samples of that frame
+ * to the device rate and queues them in the ring. It never waits: what
+ * does not fit is dropped and counted as an overrun. The consumer (the
+ * device callback or thread) pulls fixed-size periods; when the queue is
+ * short the rest of the period is filled with the last sample, which is
+ * quieter than dropping to zero, and counted as an underrun.
+ *
+ * Latency is sampled at every pull: the queue depth before the pull plus
+ * the delay of the resampling filter (half its taps, at the TIA rate). */
+
+int audio_out_init(AudioOut* ao, int rate, uint32_t buffer)
+{
+    memset(ao, 0, sizeof(AudioOut));
+    if (rate <= 0 || rate > TIA_SAMPLE_RATE * AUDIO_MAX_UPSAMPLE) return 0;
+    if (!resample_init(&ao->rs, TIA_SAMPLE_RATE, rate)) return 0;
+    if (!audioring_init(&ao->ring, buffer)) return 0;
+
+    ao->rate = rate;
+    ao->queued_min = UINT32_MAX;
+    return 1;
+}
+
+void audio_out_free(AudioOut* ao)
+{
+    audioring_free(&ao->ring);
+}
+
+/* Producer: returns the number of output samples queued */
+int audio_out_push(AudioOut* ao, const int16_t* samples, int n)
+{
+    int len, done;
+
+    if (n > TIA_AUDIO_MAX) n = TIA_AUDIO_MAX;
+    len = resample_run(&ao->rs, samples, n, ao->out);
+    done = (int)audioring_write(&ao->ring, ao->out, (uint32_t)len);
+
+    ao->produced += len;
+    if (done < len) {
+        ao->dropped += len - done;
+        ao->overruns++;
+    }
+    return done;
+}
+
+int audio_out_frame(AudioOut* ao, const EmulatorState* emu)
+{
+    return audio_out_push(ao, emu->tia.audio, emu->tia.audio_len);
+}
+
+/* Producer: 1 if n more TIA samples cannot overrun the queue */
+int audio_out_fits(const AudioOut* ao, int n)
+{
+    return audioring_space(&ao->ring) >= (uint32_t)resample_max_out(&ao->rs, n);
+}
+
+/* Rate control: factor > 1 makes more output per input sample, to fill
+ * a queue that runs low. Clamped to AUDIO_MAX_RATE_DEV so a frame's
+ * output always fits ao->out. */
+void audio_out_set_factor(AudioOut* ao, double factor)
+{
+    if (factor > 1.0 + AUDIO_MAX_RATE_DEV) factor = 1.0 + AUDIO_MAX_RATE_DEV;
+    if (factor < 1.0 - AUDIO_MAX_RATE_DEV) factor = 1.0 - AUDIO_MAX_RATE_DEV;
+    resample_set_ratio(&ao->rs, (double)TIA_SAMPLE_RATE / (ao->rate * factor));
+}
+
+/* Consumer: always fills dst with n samples */
+void audio_out_pull(AudioOut* ao, int16_t* dst, int n)
+{
+    uint32_t queued = audioring_count(&ao->ring);
+    int got;
+
+    if (queued < ao->queued_min) ao->queued_min = queued;
+    if (queued > ao->queued_max) ao->queued_max = queued;
+    ao->queued_sum += queued;
+    ao->pulls++;
+
+    got = (int)audioring_read(&ao->ring, dst, (uint32_t)n);
+    if (got) ao->last = dst[got - 1];
+    if (got < n) {
+        for (int i = got; i < n; i++) dst[i] = ao->last;
+        ao->missing += n - got;
+        ao->underruns++;
+    }
+    ao->consumed += n;
+}
+
+void audio_out_latency(const AudioOut* ao, double* min_ms, double* avg_ms, double* max_ms)
+{
+    double filter = RESAMPLE_TAPS / 2 * 1000.0 / TIA_SAMPLE_RATE;
+    double per = 1000.0 / ao->rate;
+
+    if (!ao->pulls) {
+        *min_ms = *avg_ms = *max_ms = filter;
+        return;
+    }
+    *min_ms = filter + ao->queued_min * per;
+    *avg_ms = filter + (double)ao->queued_sum / ao->pulls * per;
+    *max_ms = filter + ao->queued_max * per;
+}
@@ -0,0 +1,46 @@
+#ifndef AUDIO_H
+#define AUDIO_H
+
+#include <stdint.h>
+#include "types.h"
+#include "resample.h"
+#include "audioring.h"
+
+/* Output rates up to this many times TIA_SAMPLE_RATE */
+#define AUDIO_MAX_UPSAMPLE 4
+
+/* Rate control stays within 1 +- this, which the out buffer has room for */
+#define AUDIO_MAX_RATE_DEV 0.05
+
+typedef struct {
+    Resampler rs;
+    AudioRing ring;
+    int       rate;
+    int16_t   out[TIA_AUDIO_MAX * (AUDIO_MAX_UPSAMPLE + 1)];  /* room for rate control */
+
+    /* Producer side */
+    uint64_t  produced;
+    uint64_t  dropped;
+    uint32_t  overruns;
+
+    /* Consumer side */
+    uint64_t  consumed;
+    uint64_t  missing;
+    uint32_t  underruns;
+    int16_t   last;
+    uint32_t  queued_min;
+    uint32_t  queued_max;
+    uint64_t  queued_sum;
+    uint32_t  pulls;
+} AudioOut;
+
+int    audio_out_init(AudioOut* ao, int rate, uint32_t buffer);
+void   audio_out_free(AudioOut* ao);
+int    audio_out_push(AudioOut* ao, const int16_t* samples, int n);
+int    audio_out_frame(AudioOut* ao, const EmulatorState* emu);
+void   audio_out_pull(AudioOut* ao, int16_t* dst, int n);
+int    audio_out_fits(const AudioOut* ao, int n);
+void   audio_out_set_factor(AudioOut* ao, double factor);
+void   audio_out_latency(const AudioOut* ao, double* min_ms, double* avg_ms, double* max_ms);
+
+#endif
@@ -0,0 +1,97 @@
+#include "audioring.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Single-producer, single-consumer sample queue.
+ *
+ * The emulation loop writes and the audio output reads, without locks:
+ * head only moves in audioring_write and tail only in audioring_read.
+ * Both are free-running counters, so head - tail is the fill level even
+ * across wrap-around, and the size is a power of two so positions are a
+ * mask away. The barrier between copying the samples and publishing the
+ * new index keeps the other side from seeing the index before the data. */
+
+#define barrier() __sync_synchronize()
+
+int audioring_init(AudioRing* ring, uint32_t min_size)
+{
+    uint32_t size = 64;
+
+    memset(ring, 0, sizeof(AudioRing));
+    while (size < min_size) size <<= 1;
+
+    ring->buf = (int16_t*)malloc(size * sizeof(int16_t));
+    if (!ring->buf) return 0;
+    ring->mask = size - 1;
+    return 1;
+}
+
+void audioring_free(AudioRing* ring)
+{
+    free(ring->buf);
+    ring->buf = NULL;
+}
+
+uint32_t audioring_size(const AudioRing* ring)
+{
+    return ring->mask + 1;
+}
+
+uint32_t audioring_count(const AudioRing* ring)
+{
+    return ring->head - ring->tail;
+}
+
+uint32_t audioring_space(const AudioRing* ring)
+{
+    return ring->mask + 1 - (ring->head - ring->tail);
+}
+
+/* Copy n samples to/from the ring at counter pos, in at most two pieces */
+static void copy_in(AudioRing* ring, uint32_t pos, const int16_t* src, uint32_t n)
+{
+    uint32_t at = pos & ring->mask;
+    uint32_t first = ring->mask + 1 - at;
+
+    if (first > n) first = n;
+    memcpy(ring->buf + at, src, first * sizeof(int16_t));
+    memcpy(ring->buf, src + first, (n - first) * sizeof(int16_t));
+}
+
+static void copy_out(const AudioRing* ring, uint32_t pos, int16_t* dst, uint32_t n)
+{
+    uint32_t at = pos & ring->mask;
+    uint32_t first = ring->mask + 1 - at;
+
+    if (first > n) first = n;
+    memcpy(dst, ring->buf + at, first * sizeof(int16_t));
+    memcpy(dst + first, ring->buf, (n - first) * sizeof(int16_t));
+}
+
+/* Producer side: returns how many of the n samples fitted */
+uint32_t audioring_write(AudioRing* ring, const int16_t* src, uint32_t n)
+{
+    uint32_t head = ring->head;
+    uint32_t space = ring->mask + 1 - (head - ring->tail);
+
+    if (n > space) n = space;
+    barrier();
+    copy_in(ring, head, src, n);
+    barrier();
+    ring->head = head + n;
+    return n;
+}
+
+/* Consumer side: returns how many samples were available, up to n */
+uint32_t audioring_read(AudioRing* ring, int16_t* dst, uint32_t n)
+{
+    uint32_t tail = ring->tail;
+    uint32_t count = ring->head - tail;
+
+    if (n > count) n = count;
+    barrier();
+    copy_out(ring, tail, dst, n);
+    barrier();
+    ring->tail = tail + n;
+    return n;
+}
@@ -0,0 +1,24 @@
+#ifndef AUDIORING_H
+#define AUDIORING_H
+
+#include <stdint.h>
+
+typedef struct {
+    int16_t*          buf;
+    uint32_t          mask;
+    /* Each index is written by one side only, on its own cache line */
+    volatile uint32_t head;             /* producer */
+    uint8_t           pad0[60];
+    volatile uint32_t tail;             /* consumer */
+    uint8_t           pad1[60];
+} AudioRing;
+
+int      audioring_init(AudioRing* ring, uint32_t min_size);
+void     audioring_free(AudioRing* ring);
+uint32_t audioring_size(const AudioRing* ring);
+uint32_t audioring_count(const AudioRing* ring);
+uint32_t audioring_space(const AudioRing* ring);
+uint32_t audioring_write(AudioRing* ring, const int16_t* src, uint32_t n);
+uint32_t audioring_read(AudioRing* ring, int16_t* dst, uint32_t n);
+
+#endif
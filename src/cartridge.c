@@ -1,153 +1,522 @@
 #include "cartridge.h"
-#include <stdio.h>
-#include <stdlib.h>
+#include "hash.h"
+#include "romcache.h"
+#include "romdb.h"
 #include <string.h>
 
-static CartType detect_type(uint32_t size, const uint8_t* data)
+/* Does any of the byte strings occur in the image? Bankswitch hotspot
+ * accesses are the usual giveaway of a scheme. */
+static int has_signature(const uint8_t* data, uint32_t size,
+                         const uint8_t (*sigs)[3], int count, int len)
 {
-    (void)data;
+    for (uint32_t i = 0; i + len <= size; i++)
+        for (int k = 0; k < count; k++)
+            if (data[i] == sigs[k][0] && !memcmp(data + i, sigs[k], len)) return 1;
+    return 0;
+}
+
+static int is_probably_e0(const uint8_t* data, uint32_t size)
+{
+    static const uint8_t sigs[][3] = {
+        { 0x8D, 0xE0, 0x1F }, { 0x8D, 0xE0, 0x5F }, { 0x8D, 0xE9, 0xFF },  /* STA $xFEx */
+        { 0x0C, 0xE0, 0x1F },                                              /* NOP $1FE0 */
+        { 0xAD, 0xE0, 0x1F }, { 0xAD, 0xE9, 0xFF }, { 0xAD, 0xED, 0xFF },  /* LDA $xFEx */
+        { 0xAD, 0xF3, 0xBF },
+    };
+    return has_signature(data, size, sigs, 8, 3);
+}
+
+static int is_probably_e7(const uint8_t* data, uint32_t size)
+{
+    static const uint8_t sigs[][3] = {
+        { 0xAD, 0xE2, 0xFF }, { 0xAD, 0xE5, 0xFF }, { 0xAD, 0xE5, 0x1F },  /* LDA $xFEx */
+        { 0xAD, 0xE7, 0x1F }, { 0x0C, 0xE7, 0x1F },
+        { 0x8D, 0xE7, 0xFF }, { 0x8D, 0xE7, 0x1F },                        /* STA $xFE7 */
+    };
+    return has_signature(data, size, sigs, 7, 3);
+}
+
+static int is_probably_ua(const uint8_t* data, uint32_t size)
+{
+    static const uint8_t sigs[][3] = {
+        { 0x8D, 0x40, 0x02 }, { 0xAD, 0x40, 0x02 }, { 0xBD, 0x1F, 0x02 },  /* $0240 */
+        { 0x2C, 0xC0, 0x02 }, { 0x8D, 0xC0, 0x02 }, { 0xAD, 0xC0, 0x02 },  /* $02C0 */
+    };
+    return has_signature(data, size, sigs, 6, 3);
+}
+
+static int is_probably_cv(const uint8_t* data, uint32_t size)
+{
+    static const uint8_t sigs[][3] = {
+        { 0x9D, 0xFF, 0xF3 },   /* STA $F3FF,X */
+        { 0x99, 0x00, 0xF4 },   /* STA $F400,Y */
+    };
+    return has_signature(data, size, sigs, 2, 3);
+}
+
+/* Activision: JSR/RTS patterns around the bank switching subroutines */
+static int is_probably_fe(const uint8_t* data, uint32_t size)
+{
+    static const uint8_t sigs[][5] = {
+        { 0x20, 0x00, 0xD0, 0xC6, 0xC5 }, { 0x20, 0xC3, 0xF8, 0xA5, 0x82 },
+        { 0xD0, 0xFB, 0x20, 0x73, 0xFE }, { 0x20, 0x00, 0xF0, 0x84, 0xD6 },
+    };
+    for (uint32_t i = 0; i + 5 <= size; i++)
+        for (int k = 0; k < 4; k++)
+            if (data[i] == sigs[k][0] && !memcmp(data + i, sigs[k], 5)) return 1;
+    return 0;
+}
+
+/* Tigervision: STA $3F to switch banks, at least twice */
+static int is_probably_3f(const uint8_t* data, uint32_t size)
+{
+    int hits = 0;
+    for (uint32_t i = 0; i + 2 <= size; i++)
+        if (data[i] == 0x85 && data[i + 1] == 0x3F && ++hits >= 2) return 1;
+    return 0;
+}
+
+/* Superchip: the RAM ports (first 256 bytes of every 4K bank) hold no
+ * code, so the image has one filler value there */
+static int is_probably_sc(const uint8_t* data, uint32_t size)
+{
+    for (uint32_t bank = 0; bank < size; bank += 4096)
+        for (int i = 1; i < 256; i++)
+            if (data[bank + i] != data[bank]) return 0;
+    return 1;
+}
+
+/* Scheme guessed from size and code, for ROMs missing from the database */
+CartType cart_detect(const uint8_t* data, uint32_t size, int* superchip)
+{
+    *superchip = 0;
     switch (size) {
-        case 2048:  return CART_2K;
-        case 4096:  return CART_4K;
-        case 8192:  return CART_F8;
-        case 12288: return CART_FA;
-        case 16384: return CART_F6;
-        case 32768: return CART_F4;
-        default:
-            if (size <= 4096) return CART_4K;
-            if (size <= 8192) return CART_F8;
+        case 2048:
+            return is_probably_cv(data, size) ? CART_CV : CART_2K;
+        case 4096:
+            return is_probably_cv(data, size) ? CART_CV : CART_4K;
+        case 8192:
+            if (is_probably_sc(data, size)) { *superchip = 1; return CART_F8; }
+            if (is_probably_e0(data, size)) return CART_E0;
+            if (is_probably_3f(data, size)) return CART_3F;
+            if (is_probably_ua(data, size)) return CART_UA;
+            if (is_probably_fe(data, size)) return CART_FE;
             return CART_F8;
+        case 12288:
+            return CART_FA;
+        case 16384:
+            if (is_probably_sc(data, size)) { *superchip = 1; return CART_F6; }
+            if (is_probably_e7(data, size)) return CART_E7;
+            if (is_probably_3f(data, size)) return CART_3F;
+            return CART_F6;
+        case 32768:
+            if (is_probably_sc(data, size)) { *superchip = 1; return CART_F4; }
+            if (is_probably_3f(data, size)) return CART_3F;
+            return CART_F4;
+        default:
+            if (size < 4096) return CART_4K;
+            if (size < 8192) return CART_F8;
+            /* Only Tigervision goes past 32K */
+            return size > 32768 ? CART_3F : CART_F8;
     }
 }
 
+/* The file goes through the ROM cache: loading a game that another
+ * EmulatorState already runs shares its image */
 int cart_load(EmulatorState* emu, const char* filename)
 {
-    Cartridge* cart = &emu->cart;
-    FILE* f = fopen(filename, "rb");
-    if (!f) return 0;
+    RomImage* img = romcache_open(filename);
+    int ok;
 
-    fseek(f, 0, SEEK_END);
-    long size = ftell(f);
-    fseek(f, 0, SEEK_SET);
+    if (!img) return 0;
+    ok = cart_attach(emu, img);
+    romcache_release(img);
+    return ok;
+}
 
-    if (size <= 0 || size > 65536) {
-        fclose(f);
+/* Bank layout, hotspots and power-on banks of a scheme. Fails when the
+ * image is too small for it. */
+static int setup(Cartridge* cart, CartType type, int superchip)
+{
+    uint32_t need = 2048;
+
+    /* Superchip RAM only comes with the standard Atari schemes */
+    if (superchip && type != CART_F8 && type != CART_F6 && type != CART_F4)
         return 0;
+
+    memset(cart->extra_ram, 0, sizeof(cart->extra_ram));
+    memset(cart->bank, 0, sizeof(cart->bank));
+    cart->type = type;
+    cart->superchip = superchip;
+    cart->hot_lo = 0;
+    cart->hot_len = 0;
+    cart->num_banks = 1;
+    cart->bus_hooks = type == CART_3F || type == CART_UA;
+
+    switch (type) {
+        case CART_2K:
+        case CART_CV:
+            break;
+        case CART_4K:
+            need = 4096;
+            break;
+        case CART_F8:
+            cart->num_banks = 2;
+            cart->hot_lo = 0xFF8;
+            cart->hot_len = 2;
+            break;
+        case CART_FA:
+            cart->num_banks = 3;
+            cart->hot_lo = 0xFF8;
+            cart->hot_len = 3;
+            break;
+        case CART_F6:
+            cart->num_banks = 4;
+            cart->hot_lo = 0xFF6;
+            cart->hot_len = 4;
+            break;
+        case CART_F4:
+            cart->num_banks = 8;
+            cart->hot_lo = 0xFF4;
+            cart->hot_len = 8;
+            break;
+        case CART_FE:
+        case CART_UA:
+            /* Switched from outside the cartridge window, bank 0 at boot */
+            cart->num_banks = 2;
+            return cart->rom_size >= 8192;
+        case CART_E0:
+            /* 1K banks; power on with 4, 5, 6 and the fixed bank 7 */
+            cart->num_banks = 8;
+            cart->hot_lo = 0xFE0;
+            cart->hot_len = 0x18;
+            cart->bank[0] = 4;
+            cart->bank[1] = 5;
+            cart->bank[2] = 6;
+            return cart->rom_size >= 8192;
+        case CART_E7:
+            /* 2K banks 0-6, 1K RAM as bank 7; 4 banks of 256 bytes RAM */
+            cart->num_banks = 8;
+            cart->hot_lo = 0xFE0;
+            cart->hot_len = 0x0C;
+            return cart->rom_size >= 16384;
+        case CART_3F:
+            /* 2K banks, the last one fixed at 0x800 */
+            cart->num_banks = (int)(cart->rom_size / 2048 > 256 ? 256 : cart->rom_size / 2048);
+            return cart->rom_size >= 4096;
+        default:
+            return 0;
     }
+    if (cart->num_banks > 1) need = (uint32_t)cart->num_banks * 4096;
+
+    /* Default: last bank selected at boot */
+    cart->bank[0] = (uint8_t)(cart->num_banks - 1);
+    return cart->rom_size >= need;
+}
+
+static int attach(EmulatorState* emu, const uint8_t* data, uint32_t size, uint64_t hash,
+                  const uint8_t digest[MD5_SIZE])
+{
+    Cartridge* cart = &emu->cart;
+    const RomDbEntry* known;
+    CartType type;
+    int superchip;
+
+    if (!data || size == 0 || size > CART_MAX_ROM_SIZE) return 0;
 
-    cart->rom = (uint8_t*)malloc(size);
-    if (!cart->rom) {
-        fclose(f);
+    cart_unload(emu);
+    cart->rom = data;
+    cart->rom_size = size;
+    cart->rom_hash = hash;
+
+    known = romdb_lookup(digest, size);
+    if (known) {
+        type = (CartType)known->type;
+        superchip = known->superchip;
+        cart->tv = (TvFormat)known->tv;
+    } else {
+        type = cart_detect(data, size, &superchip);
+        cart->tv = TV_NTSC;
+    }
+    cart->known = known != NULL;
+    /* Images no scheme fits, not even 4K (under 4K but not 2K), fail */
+    if (!setup(cart, type, superchip) && !setup(cart, CART_4K, 0)) {
+        cart_unload(emu);
         return 0;
     }
+    cart_map(emu);
+
+    return 1;
+}
 
-    if ((long)fread(cart->rom, 1, size, f) != size) {
-        free(cart->rom);
-        cart->rom = NULL;
-        fclose(f);
+/* Run the loaded image with another scheme than the detected one,
+ * from the power-on banks. Fails, leaving the cartridge as it was, when
+ * the image does not fit the scheme. */
+int cart_set_type(EmulatorState* emu, CartType type, int superchip)
+{
+    Cartridge* cart = &emu->cart;
+    Cartridge old = *cart;
+
+    if (!cart->rom) return 0;
+    if (!setup(cart, type, superchip)) {
+        *cart = old;
         return 0;
     }
-    fclose(f);
+    cart_map(emu);
+    return 1;
+}
 
-    cart->rom_size = (uint32_t)size;
-    cart->type = detect_type(cart->rom_size, cart->rom);
-    cart->current_bank = 0;
-    memset(cart->extra_ram, 0, sizeof(cart->extra_ram));
+/* Run a cached image, holding a reference to it until cart_unload() */
+int cart_attach(EmulatorState* emu, RomImage* img)
+{
+    if (!img || !attach(emu, img->data, img->size, img->hash, img->md5)) return 0;
+    romcache_retain(img);
+    emu->cart.image = img;
+    return 1;
+}
 
-    switch (cart->type) {
-        case CART_2K:  cart->num_banks = 1; break;
-        case CART_4K:  cart->num_banks = 1; break;
-        case CART_F8:  cart->num_banks = 2; break;
-        case CART_FA:  cart->num_banks = 3; break;
-        case CART_F6:  cart->num_banks = 4; break;
-        case CART_F4:  cart->num_banks = 8; break;
-        default:       cart->num_banks = 1; break;
-    }
+/* Run a cached image without a reference of its own: the caller keeps
+ * one for as long as the cartridge runs it, as batch workers borrowing
+ * the main thread's images do. The digests come from the cache. */
+int cart_attach_borrowed(EmulatorState* emu, const RomImage* img)
+{
+    return img && attach(emu, img->data, img->size, img->hash, img->md5);
+}
 
-    /* Default: last bank selected at boot */
-    cart->current_bank = cart->num_banks - 1;
+/* Run a ROM image owned by the caller, which must keep it alive until
+ * cart_unload(). It is only read, so any number of EmulatorStates can
+ * share one image. */
+int cart_load_image(EmulatorState* emu, const uint8_t* data, uint32_t size)
+{
+    uint8_t digest[MD5_SIZE];
 
-    return 1;
+    if (!data || size > CART_MAX_ROM_SIZE) return 0;
+    md5(data, size, digest);
+    return attach(emu, data, size, hash64(data, size), digest);
 }
 
 void cart_unload(EmulatorState* emu)
 {
-    if (emu->cart.rom) {
-        free(emu->cart.rom);
-        emu->cart.rom = NULL;
-    }
+    romcache_release(emu->cart.image);
+    emu->cart.image = NULL;
+    emu->cart.rom = NULL;
     emu->cart.rom_size = 0;
+    emu->cart.rom_hash = 0;
+    cart_map(emu);
 }
 
-uint8_t cart_read(EmulatorState* emu, uint16_t addr)
+/* Bytes of cartridge RAM in use, the rest of extra_ram is untouched */
+uint32_t cart_ram_size(const Cartridge* cart)
 {
-    Cartridge* cart = &emu->cart;
-    if (!cart->rom) return 0xFF;
+    if (cart->superchip) return 128;
+    switch (cart->type) {
+        case CART_FA: return 256;
+        case CART_CV: return 1024;
+        case CART_E7: return 2048;
+        default:      return 0;
+    }
+}
 
-    uint16_t offset = addr & 0x0FFF;
+/* Bytes per bank of the scheme: the unit the hotspots switch, so ROM
+ * offset / bank size is the bank number */
+uint32_t cart_bank_size(const Cartridge* cart)
+{
+    switch (cart->type) {
+        case CART_E0: return 1024;
+        case CART_2K:
+        case CART_CV:
+        case CART_E7:
+        case CART_3F: return 2048;
+        default:      return 4096;
+    }
+}
 
-    /* Bankswitch hotspot detection on read */
+const char* cart_type_name(const Cartridge* cart)
+{
     switch (cart->type) {
-        case CART_F8:
-            if (offset == 0xFF8) cart->current_bank = 0;
-            else if (offset == 0xFF9) cart->current_bank = 1;
-            break;
-        case CART_F6:
-            if (offset >= 0xFF6 && offset <= 0xFF9)
-                cart->current_bank = offset - 0xFF6;
+        case CART_2K: return "2K";
+        case CART_4K: return "4K";
+        case CART_F8: return cart->superchip ? "F8SC (8K + 128 RAM)" : "F8 (8K)";
+        case CART_F6: return cart->superchip ? "F6SC (16K + 128 RAM)" : "F6 (16K)";
+        case CART_F4: return cart->superchip ? "F4SC (32K + 128 RAM)" : "F4 (32K)";
+        case CART_FE: return "FE (8K Activision)";
+        case CART_E0: return "E0 (8K Parker Bros)";
+        case CART_3F: return "3F (Tigervision)";
+        case CART_E7: return "E7 (16K M-Network)";
+        case CART_FA: return "FA (12K CBS RAM Plus)";
+        case CART_CV: return "CV (Commavid)";
+        case CART_UA: return "UA (8K UA Ltd)";
+        default:      return "Unknown";
+    }
+}
+
+/* len bytes of the window from `at` on show the ROM from `off` on.
+ * Segments past the end of the image stay unmapped (open bus). */
+static void map_rom(Cartridge* cart, int at, int len, uint32_t off)
+{
+    for (int i = 0; i < len; i += CART_SEG_SIZE) {
+        int seg = (at + i) >> CART_SEG_SHIFT;
+        cart->rd_seg[seg] = off + i + CART_SEG_SIZE <= cart->rom_size ? cart->rom + off + i : NULL;
+        cart->wr_seg[seg] = NULL;
+    }
+}
+
+/* len bytes of extra RAM from ram_off on: written at wr_at, read at rd_at */
+static void map_ram(Cartridge* cart, int wr_at, int rd_at, int len, int ram_off)
+{
+    for (int i = 0; i < len; i += CART_SEG_SIZE) {
+        cart->wr_seg[(wr_at + i) >> CART_SEG_SHIFT] = cart->extra_ram + ram_off + i;
+        cart->rd_seg[(rd_at + i) >> CART_SEG_SHIFT] = cart->extra_ram + ram_off + i;
+    }
+}
+
+static void map_segments(Cartridge* cart)
+{
+    switch (cart->type) {
+        case CART_2K:
+            map_rom(cart, 0x000, 0x800, 0);
+            map_rom(cart, 0x800, 0x800, 0);
             break;
-        case CART_F4:
-            if (offset >= 0xFF4 && offset <= 0xFFB)
-                cart->current_bank = offset - 0xFF4;
+        case CART_CV:
+            /* 1K RAM: read port 0x000-0x3FF, write port 0x400-0x7FF; the
+             * last 2K of the image at 0x800 */
+            map_ram(cart, 0x400, 0x000, 0x400, 0);
+            map_rom(cart, 0x800, 0x800, cart->rom_size - 2048);
             break;
         case CART_FA:
-            if (offset >= 0xFF8 && offset <= 0xFFA)
-                cart->current_bank = offset - 0xFF8;
-            /* CBS RAM read: 0x100-0x1FF */
-            if (offset >= 0x100 && offset <= 0x1FF)
-                return cart->extra_ram[offset & 0xFF];
+            /* CBS RAM: write port 0x000-0x0FF, read port 0x100-0x1FF */
+            map_rom(cart, 0x000, 0x1000, (uint32_t)cart->bank[0] * 4096);
+            map_ram(cart, 0x000, 0x100, 0x100, 0);
+            break;
+        case CART_E0:
+            for (int slot = 0; slot < 3; slot++)
+                map_rom(cart, slot * 0x400, 0x400, (uint32_t)(cart->bank[slot] & 7) * 1024);
+            map_rom(cart, 0xC00, 0x400, 7 * 1024);
+            break;
+        case CART_E7:
+            /* Bank 7 at 0x000 is the 1K RAM: write 0x000-0x3FF, read 0x400-0x7FF */
+            if ((cart->bank[0] & 7) == 7)
+                map_ram(cart, 0x000, 0x400, 0x400, 0);
+            else
+                map_rom(cart, 0x000, 0x800, (uint32_t)(cart->bank[0] & 7) * 2048);
+            /* 256 bytes of the second RAM: write 0x800-0x8FF, read 0x900-0x9FF */
+            map_ram(cart, 0x800, 0x900, 0x100, 1024 + (cart->bank[1] & 3) * 256);
+            map_rom(cart, 0xA00, 0x600, 7 * 2048 + 0x200);
+            break;
+        case CART_3F:
+            map_rom(cart, 0x000, 0x800, (uint32_t)cart->bank[0] * 2048);
+            map_rom(cart, 0x800, 0x800, cart->rom_size - 2048);
             break;
         default:
+            map_rom(cart, 0x000, 0x1000, (uint32_t)cart->bank[0] * 4096);
+            /* Superchip: write port 0x000-0x07F, read port 0x080-0x0FF */
+            if (cart->superchip)
+                map_ram(cart, 0x000, 0x080, 0x80, 0);
             break;
     }
+}
 
-    switch (cart->type) {
-        case CART_2K:
-            return cart->rom[offset & 0x7FF];
-        case CART_4K:
-            return cart->rom[offset];
+/* Rebuild the segment pointers for the selected banks and the
+ * 0x1000-0x1FFF page pointers from them. Pages holding hotspots stay on
+ * cart_read()/cart_write(). */
+void cart_map(EmulatorState* emu)
+{
+    Cartridge* cart = &emu->cart;
+
+    memset(cart->rd_seg, 0, sizeof(cart->rd_seg));
+    memset(cart->wr_seg, 0, sizeof(cart->wr_seg));
+    if (cart->rom) map_segments(cart);
+
+    for (int offset = 0; offset < 0x1000; offset += MEM_PAGE_SIZE) {
+        int page = (0x1000 + offset) >> MEM_PAGE_SHIFT;
+        const uint8_t* rd = cart->rd_seg[offset >> CART_SEG_SHIFT];
+        uint8_t* wr = cart->wr_seg[offset >> CART_SEG_SHIFT];
+
+        if (cart->hot_len && offset + MEM_PAGE_SIZE > cart->hot_lo &&
+            offset < cart->hot_lo + cart->hot_len) {
+            rd = NULL;
+            wr = NULL;
+        }
+        emu->read_map[page] = rd ? rd + (offset & CART_SEG_MASK) : NULL;
+        emu->write_map[page] = wr ? wr + (offset & CART_SEG_MASK) : NULL;
+    }
+}
+
+static void select_bank(EmulatorState* emu, int slot, int bank)
+{
+    if (emu->cart.bank[slot] != bank) {
+        emu->cart.bank[slot] = (uint8_t)bank;
+        cart_map(emu);
+    }
+}
+
+static void hotspot(EmulatorState* emu, uint16_t offset)
+{
+    switch (emu->cart.type) {
+        case CART_E0:
+            /* 0xFE0-0xFE7, 0xFE8-0xFEF, 0xFF0-0xFF7: slots 0, 1, 2 */
+            select_bank(emu, (offset - 0xFE0) >> 3, offset & 7);
+            break;
+        case CART_E7:
+            /* 0xFE0-0xFE7: bank at 0x000, 0xFE8-0xFEB: RAM bank at 0x800 */
+            if (offset < 0xFE8) select_bank(emu, 0, offset & 7);
+            else                select_bank(emu, 1, offset & 3);
+            break;
         default:
-            return cart->rom[(uint32_t)cart->current_bank * 4096 + offset];
+            /* Access to offset hot_lo + i selects bank i */
+            select_bank(emu, 0, offset - emu->cart.hot_lo);
+            break;
     }
 }
 
-void cart_write(EmulatorState* emu, uint16_t addr, uint8_t value)
+/* Bank switching by accesses outside the cartridge window, only called
+ * when cart.bus_hooks is set: 3F takes the bank from writes to
+ * 0x00-0x3F, UA switches on any access to 0x220 / 0x240 */
+void cart_bus_access(EmulatorState* emu, uint16_t addr, uint8_t value, int write)
 {
     Cartridge* cart = &emu->cart;
-    uint16_t offset = addr & 0x0FFF;
 
     switch (cart->type) {
-        case CART_F8:
-            if (offset == 0xFF8) cart->current_bank = 0;
-            else if (offset == 0xFF9) cart->current_bank = 1;
+        case CART_3F:
+            if (write && addr < 0x40) select_bank(emu, 0, value % cart->num_banks);
             break;
-        case CART_F6:
-            if (offset >= 0xFF6 && offset <= 0xFF9)
-                cart->current_bank = offset - 0xFF6;
-            break;
-        case CART_F4:
-            if (offset >= 0xFF4 && offset <= 0xFFB)
-                cart->current_bank = offset - 0xFF4;
-            break;
-        case CART_FA:
-            if (offset >= 0xFF8 && offset <= 0xFFA)
-                cart->current_bank = offset - 0xFF8;
-            /* CBS RAM write: 0x000-0x0FF */
-            if (offset < 0x100)
-                cart->extra_ram[offset] = value;
+        case CART_UA:
+            if ((addr & 0x1260) == 0x220) select_bank(emu, 0, 0);
+            else if ((addr & 0x1260) == 0x240) select_bank(emu, 0, 1);
             break;
         default:
             break;
     }
-    (void)value;
+}
+
+/* FE: the bank follows A13 of JSR/RTS targets, which the 6507 does not
+ * decode but the cartridge sees on the data bus while the return
+ * address goes over the stack: code at 0xFxxx is bank 0, 0xDxxx bank 1 */
+void cart_jump(EmulatorState* emu, uint16_t target)
+{
+    select_bank(emu, 0, (target & 0x2000) ? 0 : 1);
+}
+
+uint8_t cart_read(EmulatorState* emu, uint16_t addr)
+{
+    Cartridge* cart = &emu->cart;
+    uint16_t offset = addr & 0x0FFF;
+    const uint8_t* seg;
+
+    if ((uint16_t)(offset - cart->hot_lo) < cart->hot_len) hotspot(emu, offset);
+
+    seg = cart->rd_seg[offset >> CART_SEG_SHIFT];
+    return seg ? seg[offset & CART_SEG_MASK] : 0xFF;
+}
+
+void cart_write(EmulatorState* emu, uint16_t addr, uint8_t value)
+{
+    Cartridge* cart = &emu->cart;
+    uint16_t offset = addr & 0x0FFF;
+    uint8_t* seg;
+
+    if ((uint16_t)(offset - cart->hot_lo) < cart->hot_len) hotspot(emu, offset);
+
+    seg = cart->wr_seg[offset >> CART_SEG_SHIFT];
+    if (seg) seg[offset & CART_SEG_MASK] = value;
 }
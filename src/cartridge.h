@@ -4,8 +4,19 @@
 #include "types.h"
 
 int  cart_load(EmulatorState* emu, const char* filename);
+int  cart_attach(EmulatorState* emu, RomImage* img);
+int  cart_attach_borrowed(EmulatorState* emu, const RomImage* img);
+int  cart_load_image(EmulatorState* emu, const uint8_t* data, uint32_t size);
 void cart_unload(EmulatorState* emu);
 uint8_t cart_read(EmulatorState* emu, uint16_t addr);
 void cart_write(EmulatorState* emu, uint16_t addr, uint8_t value);
+void cart_map(EmulatorState* emu);
+uint32_t cart_ram_size(const Cartridge* cart);
+uint32_t cart_bank_size(const Cartridge* cart);
+CartType cart_detect(const uint8_t* data, uint32_t size, int* superchip);
+int  cart_set_type(EmulatorState* emu, CartType type, int superchip);
+const char* cart_type_name(const Cartridge* cart);
+void cart_bus_access(EmulatorState* emu, uint16_t addr, uint8_t value, int write);
+void cart_jump(EmulatorState* emu, uint16_t target);
 
 #endif
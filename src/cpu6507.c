@@ -2,6 +2,9 @@
 #include "tia.h"
 #include "riot.h"
 #include "cartridge.h"
+#include "emulator.h"
+#include "cpu6507_ops.h"
+#include "profile.h"
 #include <string.h>
 
 void cpu_init(EmulatorState* emu)
@@ -11,12 +14,16 @@ void cpu_init(EmulatorState* emu)
     emu->cpu.P = FLAG_U | FLAG_I;
 }
 
-uint8_t mem_read(EmulatorState* emu, uint16_t addr)
+/* Slow path for pages without a direct pointer: TIA, RIOT, hotspots */
+static uint8_t io_read(EmulatorState* emu, uint16_t addr)
 {
     addr &= 0x1FFF; /* 13-bit bus */
 
+    if (emu->cart.bus_hooks && !(addr & 0x1000)) cart_bus_access(emu, addr, 0, 0);
+
     if ((addr & 0x1080) == 0x0000) {
         /* TIA: A12=0, A7=0 */
+        emu_sync(emu);
         return tia_read(emu, addr);
     }
     else if ((addr & 0x1080) == 0x0080) {
@@ -33,11 +40,14 @@ uint8_t mem_read(EmulatorState* emu, uint16_t addr)
     }
 }
 
-void mem_write(EmulatorState* emu, uint16_t addr, uint8_t value)
+static void io_write(EmulatorState* emu, uint16_t addr, uint8_t value)
 {
     addr &= 0x1FFF;
 
+    if (emu->cart.bus_hooks && !(addr & 0x1000)) cart_bus_access(emu, addr, value, 1);
+
     if ((addr & 0x1080) == 0x0000) {
+        emu_sync(emu);
         tia_write(emu, addr, value);
     }
     else if ((addr & 0x1080) == 0x0080) {
@@ -52,6 +62,42 @@ void mem_write(EmulatorState* emu, uint16_t addr, uint8_t value)
     }
 }
 
+uint8_t mem_read(EmulatorState* emu, uint16_t addr)
+{
+    const uint8_t* page = emu->read_map[(addr & 0x1FFF) >> MEM_PAGE_SHIFT];
+    if (page) return page[addr & MEM_PAGE_MASK];
+    return io_read(emu, addr);
+}
+
+void mem_write(EmulatorState* emu, uint16_t addr, uint8_t value)
+{
+    uint8_t* page = emu->write_map[(addr & 0x1FFF) >> MEM_PAGE_SHIFT];
+    if (page) {
+        page[addr & MEM_PAGE_MASK] = value;
+        return;
+    }
+    io_write(emu, addr, value);
+}
+
+/* Point every RAM page at emu->ram, leave TIA/RIOT on the handlers and
+ * let the cartridge map the upper 4K. */
+void mem_map_init(EmulatorState* emu)
+{
+    for (int page = 0; page < MEM_PAGES / 2; page++) {
+        uint16_t addr = page << MEM_PAGE_SHIFT;
+
+        if ((addr & 0x0280) == 0x0080) {
+            /* RAM: A7=1, A9=0 */
+            emu->read_map[page]  = &emu->ram[addr & 0x40];
+            emu->write_map[page] = &emu->ram[addr & 0x40];
+        } else {
+            emu->read_map[page]  = NULL;
+            emu->write_map[page] = NULL;
+        }
+    }
+    cart_map(emu);
+}
+
 void cpu_reset(EmulatorState* emu)
 {
     CPU6507* c = &emu->cpu;
@@ -59,6 +105,7 @@ void cpu_reset(EmulatorState* emu)
     c->P = FLAG_U | FLAG_I;
     c->PC = mem_read(emu, 0xFFFC) | (mem_read(emu, 0xFFFD) << 8);
     c->cycles = 0;
+    c->instructions = 0;
     c->halted = 0;
 }
 
@@ -270,13 +317,19 @@ static int branch(EmulatorState* e, int cond)
     return 2;
 }
 
-/* Main step function */
-int cpu_step(EmulatorState* emu)
+/* Reference core: one big switch, kept for A/B testing the table core */
+int cpu_step_switch(EmulatorState* emu)
 {
     CPU6507* c = &emu->cpu;
 
-    if (c->halted) return 1;
+    /* RDY held low: the clock still runs */
+    if (c->halted) {
+        c->cycles++;
+        PROFILE_HALT(emu, 1);
+        return 1;
+    }
 
+    PROFILE_FETCH(emu);
     uint8_t op = mem_read(emu, c->PC++);
     AddrResult ar;
     uint8_t val;
@@ -385,6 +438,7 @@ int cpu_step(EmulatorState* emu)
             addr16 = mem_read(emu, c->PC) | (mem_read(emu, c->PC + 1) << 8);
             push16(emu, c->PC + 1);
             c->PC = addr16;
+            if (emu->cart.type == CART_FE) cart_jump(emu, c->PC);
             cycles = 6;
             break;
 
@@ -398,6 +452,7 @@ int cpu_step(EmulatorState* emu)
         /* RTS */
         case 0x60:
             c->PC = pull16(emu) + 1;
+            if (emu->cart.type == CART_FE) cart_jump(emu, c->PC);
             cycles = 6;
             break;
 
@@ -677,5 +732,288 @@ int cpu_step(EmulatorState* emu)
     }
 
     c->cycles += cycles;
+    c->instructions++;
+    PROFILE_OP(emu, op, cycles);
     return cycles;
 }
+
+/* --- Table-driven core --- */
+
+static AddrResult immd(EmulatorState* e)
+{
+    AddrResult r = { e->cpu.PC++, 0 };
+    return r;
+}
+
+/* Read operations (kind R) */
+static inline void rd_ora(CPU6507* c, uint8_t v) { c->A |= v; set_zn(c, c->A); }
+static inline void rd_and(CPU6507* c, uint8_t v) { c->A &= v; set_zn(c, c->A); }
+static inline void rd_eor(CPU6507* c, uint8_t v) { c->A ^= v; set_zn(c, c->A); }
+static inline void rd_adc(CPU6507* c, uint8_t v) { op_adc(c, v); }
+static inline void rd_sbc(CPU6507* c, uint8_t v) { op_sbc(c, v); }
+static inline void rd_cmp(CPU6507* c, uint8_t v) { op_cmp(c, c->A, v); }
+static inline void rd_cpx(CPU6507* c, uint8_t v) { op_cmp(c, c->X, v); }
+static inline void rd_cpy(CPU6507* c, uint8_t v) { op_cmp(c, c->Y, v); }
+static inline void rd_lda(CPU6507* c, uint8_t v) { c->A = v; set_zn(c, c->A); }
+static inline void rd_ldx(CPU6507* c, uint8_t v) { c->X = v; set_zn(c, c->X); }
+static inline void rd_ldy(CPU6507* c, uint8_t v) { c->Y = v; set_zn(c, c->Y); }
+static inline void rd_lax(CPU6507* c, uint8_t v) { c->A = c->X = v; set_zn(c, c->A); }
+
+static inline void rd_bit(CPU6507* c, uint8_t v)
+{
+    c->P = (c->P & ~(FLAG_Z | FLAG_V | FLAG_N))
+         | ((c->A & v) == 0 ? FLAG_Z : 0)
+         | (v & FLAG_V) | (v & FLAG_N);
+}
+
+static inline void rd_anc(CPU6507* c, uint8_t v)
+{
+    c->A &= v;
+    set_zn(c, c->A);
+    if (c->A & 0x80) c->P |= FLAG_C; else c->P &= ~FLAG_C;
+}
+
+static inline void rd_alr(CPU6507* c, uint8_t v)
+{
+    c->A &= v;
+    c->P = (c->P & ~FLAG_C) | (c->A & 1);
+    c->A >>= 1;
+    set_zn(c, c->A);
+}
+
+static inline void rd_arr(CPU6507* c, uint8_t v)
+{
+    c->A &= v;
+    int carry = c->P & FLAG_C;
+    c->A = (c->A >> 1) | (carry ? 0x80 : 0);
+    set_zn(c, c->A);
+    if (c->A & 0x40) c->P |= FLAG_C; else c->P &= ~FLAG_C;
+    if ((c->A & 0x40) ^ ((c->A & 0x20) << 1)) c->P |= FLAG_V; else c->P &= ~FLAG_V;
+}
+
+/* Store operations (kind W) */
+static inline uint8_t st_sta(CPU6507* c) { return c->A; }
+static inline uint8_t st_stx(CPU6507* c) { return c->X; }
+static inline uint8_t st_sty(CPU6507* c) { return c->Y; }
+static inline uint8_t st_sax(CPU6507* c) { return c->A & c->X; }
+
+/* Read-modify-write operations (kind M) */
+static inline uint8_t rmw_asl(CPU6507* c, uint8_t v) { return op_asl(c, v); }
+static inline uint8_t rmw_lsr(CPU6507* c, uint8_t v) { return op_lsr(c, v); }
+static inline uint8_t rmw_rol(CPU6507* c, uint8_t v) { return op_rol(c, v); }
+static inline uint8_t rmw_ror(CPU6507* c, uint8_t v) { return op_ror(c, v); }
+static inline uint8_t rmw_dec(CPU6507* c, uint8_t v) { v--; set_zn(c, v); return v; }
+static inline uint8_t rmw_inc(CPU6507* c, uint8_t v) { v++; set_zn(c, v); return v; }
+static inline uint8_t rmw_dcp(CPU6507* c, uint8_t v) { v--; op_cmp(c, c->A, v); return v; }
+static inline uint8_t rmw_isb(CPU6507* c, uint8_t v) { v++; op_sbc(c, v); return v; }
+static inline uint8_t rmw_slo(CPU6507* c, uint8_t v) { v = op_asl(c, v); c->A |= v; set_zn(c, c->A); return v; }
+static inline uint8_t rmw_rla(CPU6507* c, uint8_t v) { v = op_rol(c, v); c->A &= v; set_zn(c, c->A); return v; }
+static inline uint8_t rmw_sre(CPU6507* c, uint8_t v) { v = op_lsr(c, v); c->A ^= v; set_zn(c, c->A); return v; }
+static inline uint8_t rmw_rra(CPU6507* c, uint8_t v) { v = op_ror(c, v); op_adc(c, v); return v; }
+
+/* Implied / custom operations (kind I), return extra cycles */
+static inline int impl_brk(EmulatorState* e)
+{
+    CPU6507* c = &e->cpu;
+    c->PC++;
+    push16(e, c->PC);
+    push8(e, c->P | FLAG_B | FLAG_U);
+    c->P |= FLAG_I;
+    c->PC = mem_read(e, 0xFFFE) | (mem_read(e, 0xFFFF) << 8);
+    return 0;
+}
+
+static inline int impl_jsr(EmulatorState* e)
+{
+    CPU6507* c = &e->cpu;
+    uint16_t addr16 = mem_read(e, c->PC) | (mem_read(e, c->PC + 1) << 8);
+    push16(e, c->PC + 1);
+    c->PC = addr16;
+    if (e->cart.type == CART_FE) cart_jump(e, c->PC);
+    return 0;
+}
+
+static inline int impl_rti(EmulatorState* e)
+{
+    e->cpu.P = (pull8(e) & ~(FLAG_B | FLAG_U)) | FLAG_U;
+    e->cpu.PC = pull16(e);
+    return 0;
+}
+
+static inline int impl_rts(EmulatorState* e)
+{
+    e->cpu.PC = pull16(e) + 1;
+    if (e->cart.type == CART_FE) cart_jump(e, e->cpu.PC);
+    return 0;
+}
+
+static inline int impl_jmp(EmulatorState* e)
+{
+    CPU6507* c = &e->cpu;
+    c->PC = mem_read(e, c->PC) | (mem_read(e, c->PC + 1) << 8);
+    return 0;
+}
+
+static inline int impl_jmpi(EmulatorState* e)
+{
+    CPU6507* c = &e->cpu;
+    uint16_t ptr = mem_read(e, c->PC) | (mem_read(e, c->PC + 1) << 8);
+    /* 6502 indirect bug */
+    uint16_t lo = mem_read(e, ptr);
+    uint16_t hi = mem_read(e, (ptr & 0xFF00) | ((ptr + 1) & 0xFF));
+    c->PC = (hi << 8) | lo;
+    return 0;
+}
+
+static inline int impl_bpl(EmulatorState* e) { return branch(e, !(e->cpu.P & FLAG_N)) - 2; }
+static inline int impl_bmi(EmulatorState* e) { return branch(e, e->cpu.P & FLAG_N) - 2; }
+static inline int impl_bvc(EmulatorState* e) { return branch(e, !(e->cpu.P & FLAG_V)) - 2; }
+static inline int impl_bvs(EmulatorState* e) { return branch(e, e->cpu.P & FLAG_V) - 2; }
+static inline int impl_bcc(EmulatorState* e) { return branch(e, !(e->cpu.P & FLAG_C)) - 2; }
+static inline int impl_bcs(EmulatorState* e) { return branch(e, e->cpu.P & FLAG_C) - 2; }
+static inline int impl_bne(EmulatorState* e) { return branch(e, !(e->cpu.P & FLAG_Z)) - 2; }
+static inline int impl_beq(EmulatorState* e) { return branch(e, e->cpu.P & FLAG_Z) - 2; }
+
+static inline int impl_clc(EmulatorState* e) { e->cpu.P &= ~FLAG_C; return 0; }
+static inline int impl_sec(EmulatorState* e) { e->cpu.P |= FLAG_C; return 0; }
+static inline int impl_cli(EmulatorState* e) { e->cpu.P &= ~FLAG_I; return 0; }
+static inline int impl_sei(EmulatorState* e) { e->cpu.P |= FLAG_I; return 0; }
+static inline int impl_clv(EmulatorState* e) { e->cpu.P &= ~FLAG_V; return 0; }
+static inline int impl_cld(EmulatorState* e) { e->cpu.P &= ~FLAG_D; return 0; }
+static inline int impl_sed(EmulatorState* e) { e->cpu.P |= FLAG_D; return 0; }
+
+static inline int impl_pha(EmulatorState* e) { push8(e, e->cpu.A); return 0; }
+static inline int impl_pla(EmulatorState* e) { e->cpu.A = pull8(e); set_zn(&e->cpu, e->cpu.A); return 0; }
+static inline int impl_php(EmulatorState* e) { push8(e, e->cpu.P | FLAG_B | FLAG_U); return 0; }
+static inline int impl_plp(EmulatorState* e) { e->cpu.P = (pull8(e) & ~FLAG_B) | FLAG_U; return 0; }
+
+static inline int impl_asl_a(EmulatorState* e) { e->cpu.A = op_asl(&e->cpu, e->cpu.A); return 0; }
+static inline int impl_lsr_a(EmulatorState* e) { e->cpu.A = op_lsr(&e->cpu, e->cpu.A); return 0; }
+static inline int impl_rol_a(EmulatorState* e) { e->cpu.A = op_rol(&e->cpu, e->cpu.A); return 0; }
+static inline int impl_ror_a(EmulatorState* e) { e->cpu.A = op_ror(&e->cpu, e->cpu.A); return 0; }
+
+static inline int impl_tax(EmulatorState* e) { e->cpu.X = e->cpu.A; set_zn(&e->cpu, e->cpu.X); return 0; }
+static inline int impl_tay(EmulatorState* e) { e->cpu.Y = e->cpu.A; set_zn(&e->cpu, e->cpu.Y); return 0; }
+static inline int impl_txa(EmulatorState* e) { e->cpu.A = e->cpu.X; set_zn(&e->cpu, e->cpu.A); return 0; }
+static inline int impl_tya(EmulatorState* e) { e->cpu.A = e->cpu.Y; set_zn(&e->cpu, e->cpu.A); return 0; }
+static inline int impl_tsx(EmulatorState* e) { e->cpu.X = e->cpu.SP; set_zn(&e->cpu, e->cpu.X); return 0; }
+static inline int impl_txs(EmulatorState* e) { e->cpu.SP = e->cpu.X; return 0; }
+static inline int impl_dex(EmulatorState* e) { e->cpu.X--; set_zn(&e->cpu, e->cpu.X); return 0; }
+static inline int impl_dey(EmulatorState* e) { e->cpu.Y--; set_zn(&e->cpu, e->cpu.Y); return 0; }
+static inline int impl_inx(EmulatorState* e) { e->cpu.X++; set_zn(&e->cpu, e->cpu.X); return 0; }
+static inline int impl_iny(EmulatorState* e) { e->cpu.Y++; set_zn(&e->cpu, e->cpu.Y); return 0; }
+
+/* NOP variants: the operand bytes are skipped, not read */
+static inline int impl_nop(EmulatorState* e) { (void)e; return 0; }
+static inline int impl_dop(EmulatorState* e) { e->cpu.PC++; return 0; }
+static inline int impl_top(EmulatorState* e) { e->cpu.PC += 2; return 0; }
+static inline int impl_topx(EmulatorState* e) { return absx(e).cross; }
+
+/* KIL/JAM - halt CPU */
+static inline int impl_jam(EmulatorState* e) { e->cpu.halted = 1; return 0; }
+
+/* Expand the opcode description into one handler per opcode */
+#define OP_BODY_R(name, mode) \
+    AddrResult ar = mode(e); \
+    rd_##name(&e->cpu, mem_read(e, ar.addr)); \
+    return ar.cross;
+#define OP_BODY_W(name, mode) \
+    AddrResult ar = mode(e); \
+    mem_write(e, ar.addr, st_##name(&e->cpu)); \
+    return 0;
+#define OP_BODY_M(name, mode) \
+    AddrResult ar = mode(e); \
+    uint8_t v = rmw_##name(&e->cpu, mem_read(e, ar.addr)); \
+    mem_write(e, ar.addr, v); \
+    return 0;
+#define OP_BODY_I(name, mode) \
+    return impl_##name(e);
+
+#define OP_HANDLER(op, kind, name, mode, cycles) \
+    static inline int h_##op(EmulatorState* e) { OP_BODY_##kind(name, mode) }
+CPU_OPCODES(OP_HANDLER)
+
+typedef int (*OpHandler)(EmulatorState* e);
+
+#define OP_HANDLER_ENTRY(op, kind, name, mode, cycles) [op] = h_##op,
+static const OpHandler op_handlers[256] = { CPU_OPCODES(OP_HANDLER_ENTRY) };
+
+#define OP_CYCLES_ENTRY(op, kind, name, mode, cycles) [op] = cycles,
+static const uint8_t op_cycles[256] = { CPU_OPCODES(OP_CYCLES_ENTRY) };
+
+/* Main step function */
+int cpu_step(EmulatorState* emu)
+{
+#ifdef CPU_SWITCH_CORE
+    return cpu_step_switch(emu);
+#else
+    CPU6507* c = &emu->cpu;
+
+    /* RDY held low: the clock still runs */
+    if (c->halted) {
+        c->cycles++;
+        PROFILE_HALT(emu, 1);
+        return 1;
+    }
+
+    PROFILE_FETCH(emu);
+    uint8_t op = mem_read(emu, c->PC++);
+    int cycles = op_cycles[op] + op_handlers[op](emu);
+
+    c->cycles += cycles;
+    c->instructions++;
+    PROFILE_OP(emu, op, cycles);
+    return cycles;
+#endif
+}
+
+/* Threaded dispatch needs GCC's labels-as-values */
+#if defined(__GNUC__) && !defined(CPU_SWITCH_CORE) && !defined(CPU_NO_THREADED)
+#define CPU_THREADED 1
+#endif
+
+/* Run instructions until at least `budget` cycles have elapsed or the
+ * CPU halts (WSYNC/JAM). Returns the number of cycles executed. */
+int cpu_run(EmulatorState* emu, int budget)
+{
+    CPU6507* c = &emu->cpu;
+    int spent = 0;
+
+#ifdef CPU_THREADED
+    uint8_t op;
+    int cycles;
+
+#define OP_LABEL_ENTRY(op, kind, name, mode, cycles) [op] = &&L_##op,
+    static const void* const dispatch[256] = { CPU_OPCODES(OP_LABEL_ENTRY) };
+
+#define DISPATCH() \
+    do { \
+        if (spent >= budget || c->halted) goto done; \
+        PROFILE_FETCH(emu); \
+        op = mem_read(emu, c->PC++); \
+        goto *dispatch[op]; \
+    } while (0)
+
+#define OP_LABEL(op, kind, name, mode, cyc) \
+    L_##op: \
+        cycles = cyc + h_##op(emu); \
+        c->cycles += cycles; \
+        c->instructions++; \
+        PROFILE_OP(emu, op, cycles); \
+        spent += cycles; \
+        DISPATCH();
+
+    DISPATCH();
+    CPU_OPCODES(OP_LABEL)
+
+done:
+    (void)op;
+    return spent;
+
+#undef DISPATCH
+#else
+    while (spent < budget && !c->halted)
+        spent += cpu_step(emu);
+    return spent;
+#endif
+}
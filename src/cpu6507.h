@@ -6,7 +6,10 @@
 void    cpu_init(EmulatorState* emu);
 void    cpu_reset(EmulatorState* emu);
 int     cpu_step(EmulatorState* emu);
+int     cpu_step_switch(EmulatorState* emu);
+int     cpu_run(EmulatorState* emu, int budget);
 uint8_t mem_read(EmulatorState* emu, uint16_t addr);
 void    mem_write(EmulatorState* emu, uint16_t addr, uint8_t value);
+void    mem_map_init(EmulatorState* emu);
 
 #endif
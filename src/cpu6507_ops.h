@@ -0,0 +1,280 @@
+#ifndef CPU6507_OPS_H
+#define CPU6507_OPS_H
+
+/* ============================================
+ * 6507 opcode description
+ * ============================================
+ * One row per opcode, in opcode order:
+ *
+ *   X(opcode, kind, name, mode, cycles)
+ *
+ * kind   R = read operand and pass it to rd_<name>()
+ *        W = store the value returned by st_<name>()
+ *        M = read-modify-write through rmw_<name>()
+ *        I = implied / custom, handled entirely by impl_<name>()
+ * mode   addressing mode helper (imp for kind I)
+ * cycles base cycle count; handlers return any extra cycles
+ *        (page crossing on reads, taken branches)
+ *
+ * cpu6507.c expands this list into the handler table, the cycle
+ * table and the computed-goto dispatch of cpu_run().
+ */
+#define CPU_OPCODES(X) \
+    X(0x00, I, brk,  imp,  7) \
+    X(0x01, R, ora,  indx, 6) \
+    X(0x02, I, jam,  imp,  2) \
+    X(0x03, M, slo,  indx, 8) \
+    X(0x04, I, dop,  imp,  3) \
+    X(0x05, R, ora,  zp,   3) \
+    X(0x06, M, asl,  zp,   5) \
+    X(0x07, M, slo,  zp,   5) \
+    X(0x08, I, php,  imp,  3) \
+    X(0x09, R, ora,  immd, 2) \
+    X(0x0A, I, asl_a, imp,  2) \
+    X(0x0B, R, anc,  immd, 2) \
+    X(0x0C, I, top,  imp,  4) \
+    X(0x0D, R, ora,  abso, 4) \
+    X(0x0E, M, asl,  abso, 6) \
+    X(0x0F, M, slo,  abso, 6) \
+    X(0x10, I, bpl,  imp,  2) \
+    X(0x11, R, ora,  indy, 5) \
+    X(0x12, I, jam,  imp,  2) \
+    X(0x13, M, slo,  indy, 8) \
+    X(0x14, I, dop,  imp,  4) \
+    X(0x15, R, ora,  zpx,  4) \
+    X(0x16, M, asl,  zpx,  6) \
+    X(0x17, M, slo,  zpx,  6) \
+    X(0x18, I, clc,  imp,  2) \
+    X(0x19, R, ora,  absy, 4) \
+    X(0x1A, I, nop,  imp,  2) \
+    X(0x1B, M, slo,  absy, 7) \
+    X(0x1C, I, topx, imp,  4) \
+    X(0x1D, R, ora,  absx, 4) \
+    X(0x1E, M, asl,  absx, 7) \
+    X(0x1F, M, slo,  absx, 7) \
+    X(0x20, I, jsr,  imp,  6) \
+    X(0x21, R, and,  indx, 6) \
+    X(0x22, I, jam,  imp,  2) \
+    X(0x23, M, rla,  indx, 8) \
+    X(0x24, R, bit,  zp,   3) \
+    X(0x25, R, and,  zp,   3) \
+    X(0x26, M, rol,  zp,   5) \
+    X(0x27, M, rla,  zp,   5) \
+    X(0x28, I, plp,  imp,  4) \
+    X(0x29, R, and,  immd, 2) \
+    X(0x2A, I, rol_a, imp,  2) \
+    X(0x2B, R, anc,  immd, 2) \
+    X(0x2C, R, bit,  abso, 4) \
+    X(0x2D, R, and,  abso, 4) \
+    X(0x2E, M, rol,  abso, 6) \
+    X(0x2F, M, rla,  abso, 6) \
+    X(0x30, I, bmi,  imp,  2) \
+    X(0x31, R, and,  indy, 5) \
+    X(0x32, I, jam,  imp,  2) \
+    X(0x33, M, rla,  indy, 8) \
+    X(0x34, I, dop,  imp,  4) \
+    X(0x35, R, and,  zpx,  4) \
+    X(0x36, M, rol,  zpx,  6) \
+    X(0x37, M, rla,  zpx,  6) \
+    X(0x38, I, sec,  imp,  2) \
+    X(0x39, R, and,  absy, 4) \
+    X(0x3A, I, nop,  imp,  2) \
+    X(0x3B, M, rla,  absy, 7) \
+    X(0x3C, I, topx, imp,  4) \
+    X(0x3D, R, and,  absx, 4) \
+    X(0x3E, M, rol,  absx, 7) \
+    X(0x3F, M, rla,  absx, 7) \
+    X(0x40, I, rti,  imp,  6) \
+    X(0x41, R, eor,  indx, 6) \
+    X(0x42, I, jam,  imp,  2) \
+    X(0x43, M, sre,  indx, 8) \
+    X(0x44, I, dop,  imp,  3) \
+    X(0x45, R, eor,  zp,   3) \
+    X(0x46, M, lsr,  zp,   5) \
+    X(0x47, M, sre,  zp,   5) \
+    X(0x48, I, pha,  imp,  3) \
+    X(0x49, R, eor,  immd, 2) \
+    X(0x4A, I, lsr_a, imp,  2) \
+    X(0x4B, R, alr,  immd, 2) \
+    X(0x4C, I, jmp,  imp,  3) \
+    X(0x4D, R, eor,  abso, 4) \
+    X(0x4E, M, lsr,  abso, 6) \
+    X(0x4F, M, sre,  abso, 6) \
+    X(0x50, I, bvc,  imp,  2) \
+    X(0x51, R, eor,  indy, 5) \
+    X(0x52, I, jam,  imp,  2) \
+    X(0x53, M, sre,  indy, 8) \
+    X(0x54, I, dop,  imp,  4) \
+    X(0x55, R, eor,  zpx,  4) \
+    X(0x56, M, lsr,  zpx,  6) \
+    X(0x57, M, sre,  zpx,  6) \
+    X(0x58, I, cli,  imp,  2) \
+    X(0x59, R, eor,  absy, 4) \
+    X(0x5A, I, nop,  imp,  2) \
+    X(0x5B, M, sre,  absy, 7) \
+    X(0x5C, I, topx, imp,  4) \
+    X(0x5D, R, eor,  absx, 4) \
+    X(0x5E, M, lsr,  absx, 7) \
+    X(0x5F, M, sre,  absx, 7) \
+    X(0x60, I, rts,  imp,  6) \
+    X(0x61, R, adc,  indx, 6) \
+    X(0x62, I, jam,  imp,  2) \
+    X(0x63, M, rra,  indx, 8) \
+    X(0x64, I, dop,  imp,  3) \
+    X(0x65, R, adc,  zp,   3) \
+    X(0x66, M, ror,  zp,   5) \
+    X(0x67, M, rra,  zp,   5) \
+    X(0x68, I, pla,  imp,  4) \
+    X(0x69, R, adc,  immd, 2) \
+    X(0x6A, I, ror_a, imp,  2) \
+    X(0x6B, R, arr,  immd, 2) \
+    X(0x6C, I, jmpi, imp,  5) \
+    X(0x6D, R, adc,  abso, 4) \
+    X(0x6E, M, ror,  abso, 6) \
+    X(0x6F, M, rra,  abso, 6) \
+    X(0x70, I, bvs,  imp,  2) \
+    X(0x71, R, adc,  indy, 5) \
+    X(0x72, I, jam,  imp,  2) \
+    X(0x73, M, rra,  indy, 8) \
+    X(0x74, I, dop,  imp,  4) \
+    X(0x75, R, adc,  zpx,  4) \
+    X(0x76, M, ror,  zpx,  6) \
+    X(0x77, M, rra,  zpx,  6) \
+    X(0x78, I, sei,  imp,  2) \
+    X(0x79, R, adc,  absy, 4) \
+    X(0x7A, I, nop,  imp,  2) \
+    X(0x7B, M, rra,  absy, 7) \
+    X(0x7C, I, topx, imp,  4) \
+    X(0x7D, R, adc,  absx, 4) \
+    X(0x7E, M, ror,  absx, 7) \
+    X(0x7F, M, rra,  absx, 7) \
+    X(0x80, I, dop,  imp,  2) \
+    X(0x81, W, sta,  indx, 6) \
+    X(0x82, I, dop,  imp,  2) \
+    X(0x83, W, sax,  indx, 6) \
+    X(0x84, W, sty,  zp,   3) \
+    X(0x85, W, sta,  zp,   3) \
+    X(0x86, W, stx,  zp,   3) \
+    X(0x87, W, sax,  zp,   3) \
+    X(0x88, I, dey,  imp,  2) \
+    X(0x89, I, dop,  imp,  2) \
+    X(0x8A, I, txa,  imp,  2) \
+    X(0x8B, I, nop,  imp,  2) \
+    X(0x8C, W, sty,  abso, 4) \
+    X(0x8D, W, sta,  abso, 4) \
+    X(0x8E, W, stx,  abso, 4) \
+    X(0x8F, W, sax,  abso, 4) \
+    X(0x90, I, bcc,  imp,  2) \
+    X(0x91, W, sta,  indy, 6) \
+    X(0x92, I, jam,  imp,  2) \
+    X(0x93, I, nop,  imp,  2) \
+    X(0x94, W, sty,  zpx,  4) \
+    X(0x95, W, sta,  zpx,  4) \
+    X(0x96, W, stx,  zpy,  4) \
+    X(0x97, W, sax,  zpy,  4) \
+    X(0x98, I, tya,  imp,  2) \
+    X(0x99, W, sta,  absy, 5) \
+    X(0x9A, I, txs,  imp,  2) \
+    X(0x9B, I, nop,  imp,  2) \
+    X(0x9C, I, nop,  imp,  2) \
+    X(0x9D, W, sta,  absx, 5) \
+    X(0x9E, I, nop,  imp,  2) \
+    X(0x9F, I, nop,  imp,  2) \
+    X(0xA0, R, ldy,  immd, 2) \
+    X(0xA1, R, lda,  indx, 6) \
+    X(0xA2, R, ldx,  immd, 2) \
+    X(0xA3, R, lax,  indx, 6) \
+    X(0xA4, R, ldy,  zp,   3) \
+    X(0xA5, R, lda,  zp,   3) \
+    X(0xA6, R, ldx,  zp,   3) \
+    X(0xA7, R, lax,  zp,   3) \
+    X(0xA8, I, tay,  imp,  2) \
+    X(0xA9, R, lda,  immd, 2) \
+    X(0xAA, I, tax,  imp,  2) \
+    X(0xAB, I, nop,  imp,  2) \
+    X(0xAC, R, ldy,  abso, 4) \
+    X(0xAD, R, lda,  abso, 4) \
+    X(0xAE, R, ldx,  abso, 4) \
+    X(0xAF, R, lax,  abso, 4) \
+    X(0xB0, I, bcs,  imp,  2) \
+    X(0xB1, R, lda,  indy, 5) \
+    X(0xB2, I, jam,  imp,  2) \
+    X(0xB3, R, lax,  indy, 5) \
+    X(0xB4, R, ldy,  zpx,  4) \
+    X(0xB5, R, lda,  zpx,  4) \
+    X(0xB6, R, ldx,  zpy,  4) \
+    X(0xB7, R, lax,  zpy,  4) \
+    X(0xB8, I, clv,  imp,  2) \
+    X(0xB9, R, lda,  absy, 4) \
+    X(0xBA, I, tsx,  imp,  2) \
+    X(0xBB, I, nop,  imp,  2) \
+    X(0xBC, R, ldy,  absx, 4) \
+    X(0xBD, R, lda,  absx, 4) \
+    X(0xBE, R, ldx,  absy, 4) \
+    X(0xBF, R, lax,  absy, 4) \
+    X(0xC0, R, cpy,  immd, 2) \
+    X(0xC1, R, cmp,  indx, 6) \
+    X(0xC2, I, dop,  imp,  2) \
+    X(0xC3, M, dcp,  indx, 8) \
+    X(0xC4, R, cpy,  zp,   3) \
+    X(0xC5, R, cmp,  zp,   3) \
+    X(0xC6, M, dec,  zp,   5) \
+    X(0xC7, M, dcp,  zp,   5) \
+    X(0xC8, I, iny,  imp,  2) \
+    X(0xC9, R, cmp,  immd, 2) \
+    X(0xCA, I, dex,  imp,  2) \
+    X(0xCB, I, nop,  imp,  2) \
+    X(0xCC, R, cpy,  abso, 4) \
+    X(0xCD, R, cmp,  abso, 4) \
+    X(0xCE, M, dec,  abso, 6) \
+    X(0xCF, M, dcp,  abso, 6) \
+    X(0xD0, I, bne,  imp,  2) \
+    X(0xD1, R, cmp,  indy, 5) \
+    X(0xD2, I, jam,  imp,  2) \
+    X(0xD3, M, dcp,  indy, 8) \
+    X(0xD4, I, dop,  imp,  4) \
+    X(0xD5, R, cmp,  zpx,  4) \
+    X(0xD6, M, dec,  zpx,  6) \
+    X(0xD7, M, dcp,  zpx,  6) \
+    X(0xD8, I, cld,  imp,  2) \
+    X(0xD9, R, cmp,  absy, 4) \
+    X(0xDA, I, nop,  imp,  2) \
+    X(0xDB, M, dcp,  absy, 7) \
+    X(0xDC, I, topx, imp,  4) \
+    X(0xDD, R, cmp,  absx, 4) \
+    X(0xDE, M, dec,  absx, 7) \
+    X(0xDF, M, dcp,  absx, 7) \
+    X(0xE0, R, cpx,  immd, 2) \
+    X(0xE1, R, sbc,  indx, 6) \
+    X(0xE2, I, dop,  imp,  2) \
+    X(0xE3, M, isb,  indx, 8) \
+    X(0xE4, R, cpx,  zp,   3) \
+    X(0xE5, R, sbc,  zp,   3) \
+    X(0xE6, M, inc,  zp,   5) \
+    X(0xE7, M, isb,  zp,   5) \
+    X(0xE8, I, inx,  imp,  2) \
+    X(0xE9, R, sbc,  immd, 2) \
+    X(0xEA, I, nop,  imp,  2) \
+    X(0xEB, R, sbc,  immd, 2) \
+    X(0xEC, R, cpx,  abso, 4) \
+    X(0xED, R, sbc,  abso, 4) \
+    X(0xEE, M, inc,  abso, 6) \
+    X(0xEF, M, isb,  abso, 6) \
+    X(0xF0, I, beq,  imp,  2) \
+    X(0xF1, R, sbc,  indy, 5) \
+    X(0xF2, I, jam,  imp,  2) \
+    X(0xF3, M, isb,  indy, 8) \
+    X(0xF4, I, dop,  imp,  4) \
+    X(0xF5, R, sbc,  zpx,  4) \
+    X(0xF6, M, inc,  zpx,  6) \
+    X(0xF7, M, isb,  zpx,  6) \
+    X(0xF8, I, sed,  imp,  2) \
+    X(0xF9, R, sbc,  absy, 4) \
+    X(0xFA, I, nop,  imp,  2) \
+    X(0xFB, M, isb,  absy, 7) \
+    X(0xFC, I, topx, imp,  4) \
+    X(0xFD, R, sbc,  absx, 4) \
+    X(0xFE, M, inc,  absx, 7) \
+    X(0xFF, M, isb,  absx, 7)
+
+#endif
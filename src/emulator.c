@@ -3,6 +3,9 @@
 #include "tia.h"
 #include "riot.h"
 #include "cartridge.h"
+#include "palette.h"
+#include "savestate.h"
+#include "profile.h"
 #include <string.h>
 
 void emu_init(EmulatorState* emu)
@@ -10,10 +13,12 @@ void emu_init(EmulatorState* emu)
     memset(emu, 0, sizeof(EmulatorState));
     emu->switch_color = 1;
     emu->running = 1;
+    emu->palette = palette_get(PALETTE_NTSC);
 
     cpu_init(emu);
     tia_init(emu);
     riot_init(emu);
+    mem_map_init(emu);
 }
 
 void emu_reset(EmulatorState* emu)
@@ -24,9 +29,58 @@ void emu_reset(EmulatorState* emu)
     cpu_reset(emu);
     tia_reset(emu);
     riot_reset(emu);
+    emu->sync_cycles = emu->cpu.cycles;
 }
 
-void emu_run_frame(EmulatorState* emu)
+/* Bring the TIA up to the start of the current instruction. Called
+ * before every TIA access, so in batch mode it sees the same beam
+ * position as in lock-step. The RIOT timer needs no catch-up: it is
+ * computed from cpu.cycles when read. */
+void emu_sync(EmulatorState* emu)
+{
+    int cycles = (int)(emu->cpu.cycles - emu->sync_cycles);
+
+    if (cycles <= 0) return;
+    emu->sync_cycles = emu->cpu.cycles;
+    tia_tick(emu, cycles);
+}
+
+/* Both loops stop at FRAME_CYCLE_LIMIT (types.h) */
+static void run_frame_lockstep(EmulatorState* emu)
+{
+    uint64_t end = emu->cpu.cycles + FRAME_CYCLE_LIMIT;
+
+    while (!emu->frame_ready && emu->running && emu->cpu.cycles < end) {
+        int cycles = cpu_step(emu);
+        tia_tick(emu, cycles);
+        emu->sync_cycles = emu->cpu.cycles;
+    }
+}
+
+static void run_frame_batch(EmulatorState* emu)
+{
+    CPU6507* c = &emu->cpu;
+    uint64_t end = c->cycles + FRAME_CYCLE_LIMIT;
+
+    while (!emu->frame_ready && emu->running && c->cycles < end) {
+        /* CPU cycles until the TIA reaches the end of the line */
+        int budget = (228 - emu->tia.dot + 2) / 3;
+        if ((uint64_t)budget > end - c->cycles) budget = (int)(end - c->cycles);
+
+        if (c->halted) {
+            /* WSYNC: stall straight to the end of the line */
+            c->cycles += budget;
+            PROFILE_HALT(emu, budget);
+        } else {
+            /* ... or until the timer underflows */
+            int timer = riot_cycles_to_underflow(emu);
+            cpu_run(emu, timer < budget ? timer : budget);
+        }
+        emu_sync(emu);
+    }
+}
+
+static void run_frame(EmulatorState* emu)
 {
     emu->frame_ready = 0;
     emu->tia.frame_done = 0;
@@ -35,14 +89,78 @@ void emu_run_frame(EmulatorState* emu)
     emu->tia.inpt4 = emu->joy0_fire ? 0x00 : 0x80;
     emu->tia.inpt5 = emu->joy1_fire ? 0x00 : 0x80;
 
-    while (!emu->frame_ready && emu->running) {
-        int cycles = cpu_step(emu);
-        tia_tick(emu, cycles);
-        riot_tick(emu, cycles);
+    if (emu->sched_mode == EMU_SCHED_LOCKSTEP)
+        run_frame_lockstep(emu);
+    else
+        run_frame_batch(emu);
+}
+
+/* Run-ahead: games read the joystick mid-frame, so input shows up a
+ * frame or two later. Run the real frame without drawing it, keep its
+ * state, emulate run_ahead frames further with the same input, show the
+ * last one and go back to the kept state. */
+void emu_run_frame(EmulatorState* emu)
+{
+    uint8_t state[SAVESTATE_MAX_SIZE];
+    size_t size;
+    int audio_off = emu->tia.audio_off;
+
+    /* tia.audio holds the samples of this frame only */
+    emu->tia.audio_len = 0;
+
+    /* Nothing to show: no point running ahead */
+    if (emu->run_ahead <= 0 || emu->tia.render_off) {
+        run_frame(emu);
+        return;
     }
+
+    /* The real frame is heard, the frames ahead only seen */
+    tia_set_render_off(emu, 1);
+    run_frame(emu);
+    size = savestate_save(emu, state, sizeof(state));
+    tia_set_audio_off(emu, 1);
+    for (int i = 1; i < emu->run_ahead; i++)
+        run_frame(emu);
+    tia_set_render_off(emu, 0);
+    run_frame(emu);
+    tia_set_audio_off(emu, audio_off);
+
+    if (size) {
+        savestate_load(emu, state, size);
+        emu->frame_ready = 1;
+    }
+}
+
+void emu_set_sched_mode(EmulatorState* emu, EmuSchedMode mode)
+{
+    emu_sync(emu);
+    emu->sched_mode = mode;
+}
+
+void emu_set_run_ahead(EmulatorState* emu, int frames)
+{
+    emu->run_ahead = frames > 0 ? frames : 0;
+}
+
+void emu_set_palette(EmulatorState* emu, PaletteType type)
+{
+    emu->palette = palette_get(type);
+}
+
+/* Current frame as 0xRRGGBB pixels */
+void emu_frame_rgb(const EmulatorState* emu, uint32_t* dst)
+{
+#ifdef FB_INDEXED
+    palette_convert(emu->palette, emu->framebuffer, dst, SCREEN_W * SCREEN_H);
+#else
+    memcpy(dst, emu->framebuffer, sizeof(emu->framebuffer));
+#endif
 }
 
 void emu_shutdown(EmulatorState* emu)
 {
+#ifdef CPU_PROFILE
+    profile_free(emu);
+#endif
     cart_unload(emu);
 }
@@ -2,10 +2,16 @@
 #define EMULATOR_H
 
 #include "types.h"
+#include "palette.h"
 
 void emu_init(EmulatorState* emu);
 void emu_reset(EmulatorState* emu);
 void emu_run_frame(EmulatorState* emu);
+void emu_sync(EmulatorState* emu);
+void emu_set_sched_mode(EmulatorState* emu, EmuSchedMode mode);
+void emu_set_run_ahead(EmulatorState* emu, int frames);
+void emu_set_palette(EmulatorState* emu, PaletteType type);
+void emu_frame_rgb(const EmulatorState* emu, uint32_t* dst);
 void emu_shutdown(EmulatorState* emu);
 
 #endif
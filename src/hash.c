@@ -0,0 +1,83 @@
+#include "hash.h"
+#include <string.h>
+
+/* 64-bit FNV-1a */
+uint64_t hash64_update(uint64_t h, const void* data, size_t len)
+{
+    const uint8_t* p = (const uint8_t*)data;
+
+    while (len--) {
+        h ^= *p++;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+uint64_t hash64(const void* data, size_t len)
+{
+    return hash64_update(HASH64_INIT, data, len);
+}
+
+/* MD5 (RFC 1321), the digest ROM databases like Stella's key games on */
+static const uint32_t md5_k[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+};
+static const uint8_t md5_r[16] = { 7, 12, 17, 22, 5, 9, 14, 20, 4, 11, 16, 23, 6, 10, 15, 21 };
+
+static void md5_block(uint32_t s[4], const uint8_t* p)
+{
+    uint32_t w[16], a = s[0], b = s[1], c = s[2], d = s[3];
+
+    for (int i = 0; i < 16; i++)
+        w[i] = p[i * 4] | p[i * 4 + 1] << 8 | p[i * 4 + 2] << 16 | (uint32_t)p[i * 4 + 3] << 24;
+
+    for (int i = 0; i < 64; i++) {
+        uint32_t f, t;
+        int g;
+
+        switch (i >> 4) {
+            case 0:  f = (b & c) | (~b & d); g = i;                break;
+            case 1:  f = (d & b) | (~d & c); g = (5 * i + 1) & 15; break;
+            case 2:  f = b ^ c ^ d;          g = (3 * i + 5) & 15; break;
+            default: f = c ^ (b | ~d);       g = (7 * i) & 15;     break;
+        }
+        t = a + f + md5_k[i] + w[g];
+        a = d;
+        d = c;
+        c = b;
+        b += t << md5_r[(i >> 4) * 4 + (i & 3)] | t >> (32 - md5_r[(i >> 4) * 4 + (i & 3)]);
+    }
+    s[0] += a;
+    s[1] += b;
+    s[2] += c;
+    s[3] += d;
+}
+
+void md5(const void* data, size_t len, uint8_t digest[MD5_SIZE])
+{
+    const uint8_t* p = (const uint8_t*)data;
+    uint32_t s[4] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 };
+    uint8_t tail[128];
+    size_t rest = len & 63, pad;
+    uint64_t bits = (uint64_t)len * 8;
+
+    for (size_t i = 0; i + 64 <= len; i += 64) md5_block(s, p + i);
+
+    /* 0x80, zeros up to 56 mod 64, the length in bits */
+    memcpy(tail, p + len - rest, rest);
+    pad = rest < 56 ? 64 : 128;
+    memset(tail + rest, 0, pad - rest);
+    tail[rest] = 0x80;
+    for (int i = 0; i < 8; i++) tail[pad - 8 + i] = (uint8_t)(bits >> (i * 8));
+    md5_block(s, tail);
+    if (pad == 128) md5_block(s, tail + 64);
+
+    for (int i = 0; i < 16; i++) digest[i] = (uint8_t)(s[i >> 2] >> ((i & 3) * 8));
+}
@@ -0,0 +1,14 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HASH64_INIT 0xcbf29ce484222325ULL
+#define MD5_SIZE    16
+
+uint64_t hash64(const void* data, size_t len);
+uint64_t hash64_update(uint64_t h, const void* data, size_t len);
+void     md5(const void* data, size_t len, uint8_t digest[MD5_SIZE]);
+
+#endif
@@ -1,6 +1,10 @@
 #include "emulator.h"
 #include "cartridge.h"
 #include "cpu6507.h"
+#include "pacer.h"
+#include "profile.h"
+#include "rewind.h"
+#include "tia.h"
 #include "ui.h"
 #include <stdio.h>
 #include <string.h>
@@ -15,6 +19,24 @@
 #include <iopheap.h>
 #include <debug.h>
 
+/* ~60 bytes per frame: about a minute and a half of history */
+#define REWIND_BUDGET   (512 * 1024)
+#define REWIND_INTERVAL 60
+
+/* Frames per shown frame while fast-forwarding */
+#define FAST_FORWARD 4
+
+#ifndef RUN_AHEAD
+#define RUN_AHEAD 0
+#endif
+
+/* COP0 Count runs at the EE clock */
+#define EE_CLOCK_HZ 294912000.0
+
+static Rewind rewind_buf;
+static int rewind_ok;
+static Pacer pacer;
+
 extern unsigned char usbd_irx[];
 extern unsigned int size_usbd_irx;
 extern unsigned char usbhdfsd_irx[];
@@ -33,6 +55,28 @@ static void simple_delay(int loops)
     }
 }
 
+/* Seconds since the first call. The counter wraps every 14.5 s, so time
+ * is summed from differences; the loop reads it every frame. */
+static double now_sec(void)
+{
+    static u32 last;
+    static u64 total;
+    u32 t = cpu_ticks();
+
+    total += (u32)(t - last);
+    last = t;
+    return total / EE_CLOCK_HZ;
+}
+
+/* One frame, recorded in the rewind history when there is one */
+static void run_frame(EmulatorState* emu, int back)
+{
+    if (rewind_ok)
+        rewind_run_frame(&rewind_buf, emu, back);
+    else
+        emu_run_frame(emu);
+}
+
 static void reset_IOP(void)
 {
     SifInitRpc(0);
@@ -148,18 +192,15 @@ int main(int argc, char** argv)
     
     scr_printf("OK\n");
     scr_printf("Size: %lu bytes\n", (unsigned long)emu.cart.rom_size);
-    scr_printf("Type: ");
-    switch(emu.cart.type) {
-        case CART_2K: scr_printf("2K\n"); break;
-        case CART_4K: scr_printf("4K\n"); break;
-        case CART_F8: scr_printf("F8 (8K)\n"); break;
-        case CART_F6: scr_printf("F6 (16K)\n"); break;
-        case CART_F4: scr_printf("F4 (32K)\n"); break;
-        default: scr_printf("Unknown\n"); break;
-    }
+    scr_printf("Type: %s%s\n", cart_type_name(&emu.cart), emu.cart.known ? "" : " (guessed)");
+    if (emu.cart.tv == TV_PAL) emu_set_palette(&emu, PALETTE_PAL);
     
     scr_printf("\nResetting CPU...\n");
     emu_reset(&emu);
+    emu_set_run_ahead(&emu, RUN_AHEAD);
+#ifdef CPU_PROFILE
+    if (!profile_init(&emu)) scr_printf("Profiler: out of memory\n");
+#endif
     
     scr_printf("Reset vector: 0x%04X\n", emu.cpu.PC);
     scr_printf("First bytes: %02X %02X %02X %02X\n",
@@ -171,7 +212,12 @@ int main(int argc, char** argv)
     scr_printf("\nStarting emulation...\n");
     scr_printf("SELECT = show debug\n");
     scr_printf("START = reset\n");
-    scr_printf("TRIANGLE = exit\n\n");
+    scr_printf("TRIANGLE = exit\n");
+    scr_printf("L1 = rewind\n");
+    scr_printf("R1 = fast-forward\n\n");
+
+    rewind_ok = rewind_init(&rewind_buf, REWIND_BUDGET, REWIND_INTERVAL);
+    pacer_init(&pacer, emu.cart.tv == TV_PAL ? PACER_PAL_HZ : PACER_NTSC_HZ);
     
     simple_delay(100);
 
@@ -187,16 +233,52 @@ int main(int argc, char** argv)
         }
 
         if (emu.switch_select && (debug_counter % 60 == 0)) {
+            double jit_avg, jit_max;
+
+            pacer_jitter(&pacer, &jit_avg, &jit_max);
             scr_printf("PC:%04X A:%02X X:%02X Y:%02X P:%02X SP:%02X Scan:%d\n",
                 emu.cpu.PC, emu.cpu.A, emu.cpu.X, emu.cpu.Y, 
                 emu.cpu.P, emu.cpu.SP, emu.tia.scanline);
+            scr_printf("Display:%.2fHz %s jitter:%.2f/%.2fms rep:%u drop:%u\n",
+                pacer_display_hz(&pacer), pacer.locked ? "locked" : "paced",
+                jit_avg, jit_max, pacer.repeated, pacer.dropped);
         }
         debug_counter++;
 
-        emu_run_frame(&emu);
+        int back = rewind_ok && ui_rewind_held();
+
+        /* Fast-forward only goes forward: ignored while rewinding */
+        if (ui_fast_forward_held() && !back) {
+            /* Frames in between are not shown: skip drawing them, but
+             * keep them in the history so rewind steps one at a time */
+            tia_set_render_off(&emu, 1);
+            for (int i = 1; i < FAST_FORWARD; i++)
+                run_frame(&emu, 0);
+            tia_set_render_off(&emu, 0);
+        }
+
+        /* Frames due by the next vsync: usually one, none or two when
+         * the display does not run at the game's rate. Only the last is
+         * seen, so the ones before it are not drawn. */
+        int frames = pacer_frames(&pacer);
+        for (int i = 0; i < frames; i++) {
+            if (i < frames - 1) tia_set_render_off(&emu, 1);
+            run_frame(&emu, back);
+            tia_set_render_off(&emu, 0);
+        }
         ui_render_frame(&emu);
+        pacer_vsync(&pacer, now_sec());
     }
 
+#ifdef CPU_PROFILE
+    {
+        /* Flat profile next to the ROM */
+        char prof_path[512];
+        snprintf(prof_path, sizeof(prof_path), "%s.prof", rom_path);
+        scr_printf("Profile: %s\n", profile_dump(&emu, prof_path) ? prof_path : "write FAILED");
+    }
+#endif
+    rewind_free(&rewind_buf);
     emu_shutdown(&emu);
     ui_shutdown();
 
@@ -0,0 +1,142 @@
+#include "pacer.h"
+#include <string.h>
+
+/* Frame pacing against the console's own frame rate.
+ *
+ * The display reports each vsync with a timestamp. Timestamps are noisy
+ * (the loop wakes up late, a frame takes too long and a vsync is missed),
+ * so the pacer follows the display with a simple phase-locked loop: it
+ * predicts the next vsync from a smoothed interval and pulls the phase
+ * and the interval a little towards every measurement. The difference
+ * between the prediction and the timestamp is the jitter it reports.
+ *
+ * When the display runs within LOCK_RANGE of the emulated rate (60 Hz
+ * for 59.94, say), every vsync shows exactly one new frame: emulation
+ * runs a hair fast or slow, which nobody sees, and the audio absorbs the
+ * difference through rate control; after missed vsyncs their frames are
+ * run as well. Otherwise (a 50 Hz game on a 60 Hz display) frames are
+ * scheduled on the emulated clock: each vsync gets the frames due by the
+ * time it is shown, so some vsyncs repeat a frame or show two; beyond
+ * PACER_MAX_FRAMES the rest are dropped.
+ *
+ * Rate control keeps the audio queue around drc_target full: with the
+ * queue low the resampler stretches the sound by up to drc_max, with it
+ * high it squeezes it, so the producer follows the audio device's clock
+ * instead of drifting into underruns or overruns. At 0.5% the change of
+ * pitch is inaudible. */
+
+#define LOCK_RANGE   0.01
+#define PHASE_GAIN   0.1
+#define FREQ_GAIN    0.005
+#define DRC_MAX      0.005
+#define DRC_TARGET   0.5
+
+void pacer_init(Pacer* p, double hz)
+{
+    memset(p, 0, sizeof(Pacer));
+    p->period = 1.0 / hz;
+    p->interval = p->period;
+    p->drc_max = DRC_MAX;
+    p->drc_target = DRC_TARGET;
+    p->factor = p->factor_min = p->factor_max = 1.0;
+}
+
+void pacer_vsync(Pacer* p, double now)
+{
+    double predicted, err, dev;
+
+    p->behind = 0;
+    if (!p->vsyncs++) {
+        p->vsync = now;
+        p->emu_time = now;
+        return;
+    }
+    if (p->vsyncs == 2 && now - p->vsync > p->period / 2 && now - p->vsync < p->period * 2) {
+        /* First interval: start the loop from it rather than from the
+         * emulated rate, which may be far from the display's */
+        p->interval = now - p->vsync;
+        p->vsync = now;
+        return;
+    }
+
+    predicted = p->vsync + p->interval;
+    err = now - predicted;
+
+    /* More than half an interval late: whole vsyncs went by unseen */
+    while (err > p->interval / 2) {
+        predicted += p->interval;
+        err -= p->interval;
+        p->missed++;
+        p->behind++;
+    }
+
+    dev = err < 0 ? -err : err;
+    p->jitter_sum += dev;
+    if (dev > p->jitter_max) p->jitter_max = dev;
+
+    p->vsync = predicted + err * PHASE_GAIN;
+    p->interval += err * FREQ_GAIN;
+    if (p->interval < p->period / 2) p->interval = p->period / 2;
+    if (p->interval > p->period * 2) p->interval = p->period * 2;
+
+    dev = p->interval / p->period - 1;
+    p->locked = dev > -LOCK_RANGE && dev < LOCK_RANGE;
+}
+
+/* Frames to emulate before the next vsync */
+int pacer_frames(Pacer* p)
+{
+    double next = p->vsync + p->interval;
+    int n;
+
+    if (p->locked) {
+        /* Keep the emulated clock with the display for a later switch;
+         * frames of missed vsyncs are caught up */
+        p->emu_time = next;
+        n = 1 + p->behind;
+        p->behind = 0;
+        if (n > PACER_MAX_FRAMES) {
+            p->dropped += n - PACER_MAX_FRAMES;
+            n = PACER_MAX_FRAMES;
+        }
+    } else {
+        /* Due frames, rounded to the nearest vsync */
+        double due = (next + p->period / 2 - p->emu_time) / p->period;
+
+        n = due > 0 ? (int)due : 0;
+        p->emu_time += n * p->period;
+        if (n > PACER_MAX_FRAMES) {
+            p->dropped += n - PACER_MAX_FRAMES;
+            n = PACER_MAX_FRAMES;
+        }
+        if (!n) p->repeated++;
+    }
+    p->frames += n;
+    return n;
+}
+
+/* Rate correction for the audio producer, given the fill of its queue:
+ * above 1 it should make more output samples per input sample */
+double pacer_drc(Pacer* p, uint32_t queued, uint32_t size)
+{
+    double fill = (double)queued / size;
+    double k = (p->drc_target - fill) / p->drc_target;
+
+    if (k > 1) k = 1;
+    if (k < -1) k = -1;
+    p->factor = 1 + k * p->drc_max;
+    if (p->factor < p->factor_min) p->factor_min = p->factor;
+    if (p->factor > p->factor_max) p->factor_max = p->factor;
+    return p->factor;
+}
+
+double pacer_display_hz(const Pacer* p)
+{
+    return 1.0 / p->interval;
+}
+
+void pacer_jitter(const Pacer* p, double* avg_ms, double* max_ms)
+{
+    *avg_ms = p->vsyncs > 1 ? p->jitter_sum * 1000.0 / (p->vsyncs - 1) : 0.0;
+    *max_ms = p->jitter_max * 1000.0;
+}
@@ -0,0 +1,43 @@
+#ifndef PACER_H
+#define PACER_H
+
+#include <stdint.h>
+
+#define PACER_NTSC_HZ    59.94
+#define PACER_PAL_HZ     50.0
+#define PACER_MAX_FRAMES 2
+
+typedef struct {
+    double   period;        /* emulated frame, seconds */
+    double   emu_time;      /* where the emulated clock is */
+    int      locked;        /* one frame per vsync */
+
+    /* Display clock, smoothed */
+    double   vsync;
+    double   interval;
+    uint32_t vsyncs;
+    uint32_t missed;
+    int      behind;        /* vsyncs missed since the last one seen */
+    double   jitter_sum;
+    double   jitter_max;
+
+    /* Audio rate control */
+    double   drc_max;       /* largest correction, as a fraction */
+    double   drc_target;    /* wanted queue fill, fraction of its size */
+    double   factor;
+    double   factor_min;
+    double   factor_max;
+
+    uint32_t frames;
+    uint32_t repeated;      /* vsyncs that showed the previous frame again */
+    uint32_t dropped;       /* frames skipped to catch up */
+} Pacer;
+
+void   pacer_init(Pacer* p, double hz);
+void   pacer_vsync(Pacer* p, double now);
+int    pacer_frames(Pacer* p);
+double pacer_drc(Pacer* p, uint32_t queued, uint32_t size);
+double pacer_display_hz(const Pacer* p);
+void   pacer_jitter(const Pacer* p, double* avg_ms, double* max_ms);
+
+#endif
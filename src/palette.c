@@ -0,0 +1,177 @@
+#include "palette.h"
+
+/* Full NTSC palette (128 colors, luminance pairs) */
+static const uint32_t ntsc_palette[256] = {
+    /* 0x00 */ 0x000000, 0x000000, 0x4a4a4a, 0x4a4a4a,
+    /* 0x04 */ 0x6f6f6f, 0x6f6f6f, 0x8e8e8e, 0x8e8e8e,
+    /* 0x08 */ 0xaaaaaa, 0xaaaaaa, 0xc0c0c0, 0xc0c0c0,
+    /* 0x0C */ 0xd6d6d6, 0xd6d6d6, 0xececec, 0xececec,
+    /* 0x10 */ 0x484800, 0x484800, 0x69690f, 0x69690f,
+    /* 0x14 */ 0x86861d, 0x86861d, 0xa2a22a, 0xa2a22a,
+    /* 0x18 */ 0xbbbb35, 0xbbbb35, 0xd2d240, 0xd2d240,
+    /* 0x1C */ 0xe8e84a, 0xe8e84a, 0xfcfc54, 0xfcfc54,
+    /* 0x20 */ 0x7c2c00, 0x7c2c00, 0x904811, 0x904811,
+    /* 0x24 */ 0xa26221, 0xa26221, 0xb47a30, 0xb47a30,
+    /* 0x28 */ 0xc3903d, 0xc3903d, 0xd2a44a, 0xd2a44a,
+    /* 0x2C */ 0xdfb755, 0xdfb755, 0xecc860, 0xecc860,
+    /* 0x30 */ 0x901c00, 0x901c00, 0xa33915, 0xa33915,
+    /* 0x34 */ 0xb55328, 0xb55328, 0xc56b3a, 0xc56b3a,
+    /* 0x38 */ 0xd5804a, 0xd5804a, 0xe39359, 0xe39359,
+    /* 0x3C */ 0xf0a567, 0xf0a567, 0xfcb574, 0xfcb574,
+    /* 0x40 */ 0x940000, 0x940000, 0xa71a1a, 0xa71a1a,
+    /* 0x44 */ 0xb83232, 0xb83232, 0xc84848, 0xc84848,
+    /* 0x48 */ 0xd65c5c, 0xd65c5c, 0xe46e6e, 0xe46e6e,
+    /* 0x4C */ 0xf08080, 0xf08080, 0xfc9090, 0xfc9090,
+    /* 0x50 */ 0x840064, 0x840064, 0x97197a, 0x97197a,
+    /* 0x54 */ 0xa8308f, 0xa8308f, 0xb846a2, 0xb846a2,
+    /* 0x58 */ 0xc659b3, 0xc659b3, 0xd46cc3, 0xd46cc3,
+    /* 0x5C */ 0xe07cd2, 0xe07cd2, 0xec8ce0, 0xec8ce0,
+    /* 0x60 */ 0x500084, 0x500084, 0x68199a, 0x68199a,
+    /* 0x64 */ 0x7d30ad, 0x7d30ad, 0x9246c0, 0x9246c0,
+    /* 0x68 */ 0xa459d0, 0xa459d0, 0xb56ce0, 0xb56ce0,
+    /* 0x6C */ 0xc57cee, 0xc57cee, 0xd48cfc, 0xd48cfc,
+    /* 0x70 */ 0x140090, 0x140090, 0x331aa3, 0x331aa3,
+    /* 0x74 */ 0x4e32b5, 0x4e32b5, 0x6848c6, 0x6848c6,
+    /* 0x78 */ 0x7f5cd5, 0x7f5cd5, 0x956ee3, 0x956ee3,
+    /* 0x7C */ 0xa980f0, 0xa980f0, 0xbc90fc, 0xbc90fc,
+    /* 0x80 */ 0x000094, 0x000094, 0x181aa7, 0x181aa7,
+    /* 0x84 */ 0x2d32b8, 0x2d32b8, 0x4248c8, 0x4248c8,
+    /* 0x88 */ 0x545cd6, 0x545cd6, 0x656ee4, 0x656ee4,
+    /* 0x8C */ 0x7580f0, 0x7580f0, 0x8490fc, 0x8490fc,
+    /* 0x90 */ 0x001c88, 0x001c88, 0x183b9d, 0x183b9d,
+    /* 0x94 */ 0x2d57b0, 0x2d57b0, 0x4272c2, 0x4272c2,
+    /* 0x98 */ 0x548ad2, 0x548ad2, 0x65a0e1, 0x65a0e1,
+    /* 0x9C */ 0x75b5ef, 0x75b5ef, 0x84c8fc, 0x84c8fc,
+    /* 0xA0 */ 0x003064, 0x003064, 0x185080, 0x185080,
+    /* 0xA4 */ 0x2d6d98, 0x2d6d98, 0x4288b0, 0x4288b0,
+    /* 0xA8 */ 0x54a0c5, 0x54a0c5, 0x65b7d9, 0x65b7d9,
+    /* 0xAC */ 0x75cceb, 0x75cceb, 0x84e0fc, 0x84e0fc,
+    /* 0xB0 */ 0x004400, 0x004400, 0x1a661a, 0x1a661a,
+    /* 0xB4 */ 0x328432, 0x328432, 0x48a048, 0x48a048,
+    /* 0xB8 */ 0x5cb85c, 0x5cb85c, 0x6ece6e, 0x6ece6e,
+    /* 0xBC */ 0x80e280, 0x80e280, 0x90f490, 0x90f490,
+    /* 0xC0 */ 0x143c00, 0x143c00, 0x355f18, 0x355f18,
+    /* 0xC4 */ 0x527e2d, 0x527e2d, 0x6e9c42, 0x6e9c42,
+    /* 0xC8 */ 0x87b754, 0x87b754, 0x9ed065, 0x9ed065,
+    /* 0xCC */ 0xb4e775, 0xb4e775, 0xc8fc84, 0xc8fc84,
+    /* 0xD0 */ 0x303800, 0x303800, 0x505916, 0x505916,
+    /* 0xD4 */ 0x6d762b, 0x6d762b, 0x88923e, 0x88923e,
+    /* 0xD8 */ 0xa0ab4f, 0xa0ab4f, 0xb7c25f, 0xb7c25f,
+    /* 0xDC */ 0xccd86e, 0xccd86e, 0xe0ec7c, 0xe0ec7c,
+    /* 0xE0 */ 0x482c00, 0x482c00, 0x694d14, 0x694d14,
+    /* 0xE4 */ 0x866a26, 0x866a26, 0xa28638, 0xa28638,
+    /* 0xE8 */ 0xbb9f47, 0xbb9f47, 0xd2b656, 0xd2b656,
+    /* 0xEC */ 0xe8cc63, 0xe8cc63, 0xfce070, 0xfce070,
+    /* 0xF0 */ 0x681400, 0x681400, 0x833915, 0x833915,
+    /* 0xF4 */ 0x9b5b28, 0x9b5b28, 0xb07b3a, 0xb07b3a,
+    /* 0xF8 */ 0xc4984a, 0xc4984a, 0xd6b359, 0xd6b359,
+    /* 0xFC */ 0xe8cc67, 0xe8cc67, 0xf8e474, 0xf8e474,
+};
+
+/* PAL palette: hue rows 0x00-0x10 and 0xE0-0xF0 are grey */
+static const uint32_t pal_palette[256] = {
+    /* 0x00 */ 0x000000, 0x000000, 0x2b2b2b, 0x2b2b2b,
+    /* 0x04 */ 0x525252, 0x525252, 0x767676, 0x767676,
+    /* 0x08 */ 0x979797, 0x979797, 0xb6b6b6, 0xb6b6b6,
+    /* 0x0C */ 0xd2d2d2, 0xd2d2d2, 0xececec, 0xececec,
+    /* 0x10 */ 0x000000, 0x000000, 0x2b2b2b, 0x2b2b2b,
+    /* 0x14 */ 0x525252, 0x525252, 0x767676, 0x767676,
+    /* 0x18 */ 0x979797, 0x979797, 0xb6b6b6, 0xb6b6b6,
+    /* 0x1C */ 0xd2d2d2, 0xd2d2d2, 0xececec, 0xececec,
+    /* 0x20 */ 0x805800, 0x805800, 0x96711a, 0x96711a,
+    /* 0x24 */ 0xab8732, 0xab8732, 0xbe9c48, 0xbe9c48,
+    /* 0x28 */ 0xcfaf5c, 0xcfaf5c, 0xdfc06f, 0xdfc06f,
+    /* 0x2C */ 0xeed180, 0xeed180, 0xfce090, 0xfce090,
+    /* 0x30 */ 0x445c00, 0x445c00, 0x5e791a, 0x5e791a,
+    /* 0x34 */ 0x769332, 0x769332, 0x8cac48, 0x8cac48,
+    /* 0x38 */ 0xa0c25c, 0xa0c25c, 0xb3d76f, 0xb3d76f,
+    /* 0x3C */ 0xc4ea80, 0xc4ea80, 0xd4fc90, 0xd4fc90,
+    /* 0x40 */ 0x703400, 0x703400, 0x89511a, 0x89511a,
+    /* 0x44 */ 0xa06b32, 0xa06b32, 0xb68448, 0xb68448,
+    /* 0x48 */ 0xc99a5c, 0xc99a5c, 0xdcaf6f, 0xdcaf6f,
+    /* 0x4C */ 0xecc280, 0xecc280, 0xfcd490, 0xfcd490,
+    /* 0x50 */ 0x006414, 0x006414, 0x1a8035, 0x1a8035,
+    /* 0x54 */ 0x329852, 0x329852, 0x48b06e, 0x48b06e,
+    /* 0x58 */ 0x5cc485, 0x5cc485, 0x6fd89c, 0x6fd89c,
+    /* 0x5C */ 0x80eab0, 0x80eab0, 0x90fcc4, 0x90fcc4,
+    /* 0x60 */ 0x700014, 0x700014, 0x891a35, 0x891a35,
+    /* 0x64 */ 0xa03252, 0xa03252, 0xb6486e, 0xb6486e,
+    /* 0x68 */ 0xc95c85, 0xc95c85, 0xdc6f9c, 0xdc6f9c,
+    /* 0x6C */ 0xec80b0, 0xec80b0, 0xfc90c4, 0xfc90c4,
+    /* 0x70 */ 0x005c5c, 0x005c5c, 0x1a7676, 0x1a7676,
+    /* 0x74 */ 0x328e8e, 0x328e8e, 0x48a4a4, 0x48a4a4,
+    /* 0x78 */ 0x5cb8b8, 0x5cb8b8, 0x6fcbcb, 0x6fcbcb,
+    /* 0x7C */ 0x80dcdc, 0x80dcdc, 0x90ecec, 0x90ecec,
+    /* 0x80 */ 0x70005c, 0x70005c, 0x841a74, 0x841a74,
+    /* 0x84 */ 0x963289, 0x963289, 0xa8489e, 0xa8489e,
+    /* 0x88 */ 0xb75cb0, 0xb75cb0, 0xc66fc1, 0xc66fc1,
+    /* 0x8C */ 0xd380d1, 0xd380d1, 0xe090e0, 0xe090e0,
+    /* 0x90 */ 0x003c70, 0x003c70, 0x195a89, 0x195a89,
+    /* 0x94 */ 0x2f75a0, 0x2f75a0, 0x448eb6, 0x448eb6,
+    /* 0x98 */ 0x57a5c9, 0x57a5c9, 0x68badc, 0x68badc,
+    /* 0x9C */ 0x79ceec, 0x79ceec, 0x88e0fc, 0x88e0fc,
+    /* 0xA0 */ 0x580070, 0x580070, 0x6e1a89, 0x6e1a89,
+    /* 0xA4 */ 0x8332a0, 0x8332a0, 0x9648b6, 0x9648b6,
+    /* 0xA8 */ 0xa75cc9, 0xa75cc9, 0xb76fdc, 0xb76fdc,
+    /* 0xAC */ 0xc680ec, 0xc680ec, 0xd490fc, 0xd490fc,
+    /* 0xB0 */ 0x002070, 0x002070, 0x193f89, 0x193f89,
+    /* 0xB4 */ 0x2f5aa0, 0x2f5aa0, 0x4474b6, 0x4474b6,
+    /* 0xB8 */ 0x578bc9, 0x578bc9, 0x68a1dc, 0x68a1dc,
+    /* 0xBC */ 0x79b5ec, 0x79b5ec, 0x88c8fc, 0x88c8fc,
+    /* 0xC0 */ 0x340080, 0x340080, 0x4a1a96, 0x4a1a96,
+    /* 0xC4 */ 0x5f32ab, 0x5f32ab, 0x7248be, 0x7248be,
+    /* 0xC8 */ 0x835ccf, 0x835ccf, 0x936fdf, 0x936fdf,
+    /* 0xCC */ 0xa280ee, 0xa280ee, 0xb090fc, 0xb090fc,
+    /* 0xD0 */ 0x000088, 0x000088, 0x1a1a9d, 0x1a1a9d,
+    /* 0xD4 */ 0x3232b0, 0x3232b0, 0x4848c2, 0x4848c2,
+    /* 0xD8 */ 0x5c5cd2, 0x5c5cd2, 0x6f6fe1, 0x6f6fe1,
+    /* 0xDC */ 0x8080ef, 0x8080ef, 0x9090fc, 0x9090fc,
+    /* 0xE0 */ 0x000000, 0x000000, 0x2b2b2b, 0x2b2b2b,
+    /* 0xE4 */ 0x525252, 0x525252, 0x767676, 0x767676,
+    /* 0xE8 */ 0x979797, 0x979797, 0xb6b6b6, 0xb6b6b6,
+    /* 0xEC */ 0xd2d2d2, 0xd2d2d2, 0xececec, 0xececec,
+    /* 0xF0 */ 0x000000, 0x000000, 0x2b2b2b, 0x2b2b2b,
+    /* 0xF4 */ 0x525252, 0x525252, 0x767676, 0x767676,
+    /* 0xF8 */ 0x979797, 0x979797, 0xb6b6b6, 0xb6b6b6,
+    /* 0xFC */ 0xd2d2d2, 0xd2d2d2, 0xececec, 0xececec,
+};
+
+/* SECAM: eight colors selected by the luminance bits, hue ignored */
+#define SECAM_ROW \
+    0x000000, 0x000000, 0x2121ff, 0x2121ff, 0xf03c79, 0xf03c79, 0xff50ff, 0xff50ff, \
+    0x7fff00, 0x7fff00, 0x7fffff, 0x7fffff, 0xffff3f, 0xffff3f, 0xffffff, 0xffffff
+
+static const uint32_t secam_palette[256] = {
+    SECAM_ROW, SECAM_ROW, SECAM_ROW, SECAM_ROW,
+    SECAM_ROW, SECAM_ROW, SECAM_ROW, SECAM_ROW,
+    SECAM_ROW, SECAM_ROW, SECAM_ROW, SECAM_ROW,
+    SECAM_ROW, SECAM_ROW, SECAM_ROW, SECAM_ROW,
+};
+
+const uint32_t* palette_get(PaletteType type)
+{
+    switch (type) {
+        case PALETTE_PAL:   return pal_palette;
+        case PALETTE_SECAM: return secam_palette;
+        default:            return ntsc_palette;
+    }
+}
+
+/* Index -> RGB, eight pixels per iteration */
+void palette_convert(const uint32_t* pal, const uint8_t* src, uint32_t* dst, int count)
+{
+    int i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        uint32_t c0 = pal[src[i + 0]], c1 = pal[src[i + 1]];
+        uint32_t c2 = pal[src[i + 2]], c3 = pal[src[i + 3]];
+        uint32_t c4 = pal[src[i + 4]], c5 = pal[src[i + 5]];
+        uint32_t c6 = pal[src[i + 6]], c7 = pal[src[i + 7]];
+        dst[i + 0] = c0; dst[i + 1] = c1;
+        dst[i + 2] = c2; dst[i + 3] = c3;
+        dst[i + 4] = c4; dst[i + 5] = c5;
+        dst[i + 6] = c6; dst[i + 7] = c7;
+    }
+    for (; i < count; i++)
+        dst[i] = pal[src[i]];
+}
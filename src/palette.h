@@ -0,0 +1,15 @@
+#ifndef PALETTE_H
+#define PALETTE_H
+
+#include "types.h"
+
+typedef enum {
+    PALETTE_NTSC = 0,
+    PALETTE_PAL,
+    PALETTE_SECAM
+} PaletteType;
+
+const uint32_t* palette_get(PaletteType type);
+void palette_convert(const uint32_t* pal, const uint8_t* src, uint32_t* dst, int count);
+
+#endif
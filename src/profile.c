@@ -0,0 +1,265 @@
+#include "profile.h"
+
+#ifdef CPU_PROFILE
+
+#include "cartridge.h"
+#include "cpu6507_ops.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Execution profiler.
+ *
+ * The CPU cores call profile_fetch() before each opcode fetch and
+ * profile_count() with the opcode and its cycles once it has run. The
+ * fetch resolves PC through the cartridge's segment pointers to a ROM
+ * offset, so code at the same address in different banks is counted
+ * apart; code running outside the ROM (RIOT RAM, cartridge RAM) is
+ * counted per bus address. Cycles the CPU spends stopped by WSYNC are
+ * added by the schedulers, which skip them without running the core.
+ *
+ * profile_report() prints the opcode mix and the hottest locations;
+ * profile_dump() writes every executed location, one per line in
+ * address order, so two runs of a ROM can be diffed. */
+
+/* Implied-kind rows carry their own addressing (branches, JMP, ...) */
+#define OP_NAME_R(name, mode) #name " " #mode
+#define OP_NAME_W(name, mode) #name " " #mode
+#define OP_NAME_M(name, mode) #name " " #mode
+#define OP_NAME_I(name, mode) #name
+#define OP_NAME_ENTRY(op, kind, name, mode, cycles) [op] = OP_NAME_##kind(name, mode),
+static const char* const op_names[256] = { CPU_OPCODES(OP_NAME_ENTRY) };
+
+typedef struct {
+    int32_t  at;
+    uint32_t count;
+    uint32_t cycles;
+} Spot;
+
+int profile_init(EmulatorState* emu)
+{
+    Profile* p;
+    uint32_t size = emu->cart.rom_size;
+
+    profile_free(emu);
+    p = (Profile*)calloc(1, sizeof(Profile));
+    if (!p) return 0;
+
+    p->rom_size = size;
+    p->rom_count = (uint32_t*)calloc(size ? size : 1, sizeof(uint32_t));
+    p->rom_cycles = (uint32_t*)calloc(size ? size : 1, sizeof(uint32_t));
+    p->rom_pc = (uint16_t*)calloc(size ? size : 1, sizeof(uint16_t));
+    emu->profile = p;
+    if (!p->rom_count || !p->rom_cycles || !p->rom_pc) {
+        profile_free(emu);
+        return 0;
+    }
+    return 1;
+}
+
+void profile_free(EmulatorState* emu)
+{
+    Profile* p = emu->profile;
+
+    if (!p) return;
+    free(p->rom_count);
+    free(p->rom_cycles);
+    free(p->rom_pc);
+    free(p);
+    emu->profile = NULL;
+}
+
+void profile_reset(EmulatorState* emu)
+{
+    Profile* p = emu->profile;
+
+    if (!p) return;
+    memset(p->op_count, 0, sizeof(p->op_count));
+    memset(p->op_cycles, 0, sizeof(p->op_cycles));
+    memset(p->rom_count, 0, p->rom_size * sizeof(uint32_t));
+    memset(p->rom_cycles, 0, p->rom_size * sizeof(uint32_t));
+    memset(p->bus_count, 0, sizeof(p->bus_count));
+    memset(p->bus_cycles, 0, sizeof(p->bus_cycles));
+    p->halted_cycles = 0;
+    p->wsyncs = 0;
+}
+
+void profile_fetch(EmulatorState* emu)
+{
+    Profile* p = emu->profile;
+    uint16_t pc = emu->cpu.PC & 0x1FFF;
+
+    p->pc = emu->cpu.PC;
+    p->at = -1 - pc;
+    if (pc & 0x1000) {
+        const uint8_t* seg = emu->cart.rd_seg[(pc & 0xFFF) >> CART_SEG_SHIFT];
+        const uint8_t* rom = emu->cart.rom;
+
+        if (seg && rom && seg >= rom && seg < rom + p->rom_size)
+            p->at = (int32_t)(seg - rom) + (pc & CART_SEG_MASK);
+    }
+}
+
+void profile_count(EmulatorState* emu, uint8_t op, int cycles)
+{
+    Profile* p = emu->profile;
+
+    p->op_count[op]++;
+    p->op_cycles[op] += cycles;
+    if (p->at >= 0) {
+        p->rom_count[p->at]++;
+        p->rom_cycles[p->at] += cycles;
+        p->rom_pc[p->at] = p->pc;
+    } else {
+        p->bus_count[-1 - p->at]++;
+        p->bus_cycles[-1 - p->at] += cycles;
+    }
+}
+
+static int spot_cmp(const void* a, const void* b)
+{
+    const Spot* x = (const Spot*)a;
+    const Spot* y = (const Spot*)b;
+
+    if (x->cycles != y->cycles) return x->cycles < y->cycles ? 1 : -1;
+    return x->at < y->at ? -1 : x->at > y->at;
+}
+
+static uint64_t total_cycles(const Profile* p)
+{
+    uint64_t sum = 0;
+
+    for (int i = 0; i < 256; i++) sum += p->op_cycles[i];
+    return sum;
+}
+
+static void print_spot(const EmulatorState* emu, FILE* f, const Spot* s, uint64_t total)
+{
+    const Profile* p = emu->profile;
+    int bank_size = (int)cart_bank_size(&emu->cart);
+    double pct = total ? s->cycles * 100.0 / total : 0.0;
+
+    if (s->at >= 0) {
+        fprintf(f, "  bank %3d $%04X  rom %05X  %10u %12u %6.2f%%  %s\n",
+                s->at / bank_size, p->rom_pc[s->at], (unsigned)s->at, s->count, s->cycles,
+                pct, op_names[emu->cart.rom[s->at]]);
+    } else {
+        fprintf(f, "  bus      $%04X             %10u %12u %6.2f%%\n",
+                (unsigned)(-1 - s->at), s->count, s->cycles, pct);
+    }
+}
+
+/* Locations that ran at least once */
+static Spot* collect(const Profile* p, int* n)
+{
+    Spot* spots = (Spot*)malloc((p->rom_size + 0x2000) * sizeof(Spot));
+    int count = 0;
+
+    if (!spots) return NULL;
+    for (uint32_t i = 0; i < p->rom_size; i++) {
+        if (!p->rom_count[i]) continue;
+        spots[count].at = (int32_t)i;
+        spots[count].count = p->rom_count[i];
+        spots[count].cycles = p->rom_cycles[i];
+        count++;
+    }
+    for (int i = 0; i < 0x2000; i++) {
+        if (!p->bus_count[i]) continue;
+        spots[count].at = -1 - i;
+        spots[count].count = p->bus_count[i];
+        spots[count].cycles = p->bus_cycles[i];
+        count++;
+    }
+    *n = count;
+    return spots;
+}
+
+/* Opcode mix and the `top` hottest locations, by cycles */
+void profile_report(const EmulatorState* emu, FILE* f, int top)
+{
+    const Profile* p = emu->profile;
+    uint64_t total, instr = 0;
+    int order[256], n;
+    Spot* spots;
+
+    if (!p) return;
+    total = total_cycles(p);
+    for (int i = 0; i < 256; i++) {
+        instr += p->op_count[i];
+        order[i] = i;
+    }
+    /* Opcodes by cycles, insertion sort is plenty for 256 */
+    for (int i = 1; i < 256; i++) {
+        int o = order[i], j = i;
+        while (j > 0 && p->op_cycles[order[j - 1]] < p->op_cycles[o]) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = o;
+    }
+
+    fprintf(f, "profile      %llu instructions, %llu cycles; %llu more halted by %llu WSYNC "
+               "(%.1f%% of all cycles)\n",
+            (unsigned long long)instr, (unsigned long long)total,
+            (unsigned long long)p->halted_cycles, (unsigned long long)p->wsyncs,
+            total + p->halted_cycles ?
+                p->halted_cycles * 100.0 / (total + p->halted_cycles) : 0.0);
+
+    fprintf(f, "opcodes                          count       cycles\n");
+    for (int i = 0; i < top && i < 256 && p->op_count[order[i]]; i++) {
+        int op = order[i];
+        fprintf(f, "  %02X %-12s %16llu %12llu %6.2f%%\n", op, op_names[op],
+                (unsigned long long)p->op_count[op], (unsigned long long)p->op_cycles[op],
+                total ? p->op_cycles[op] * 100.0 / total : 0.0);
+    }
+
+    spots = collect(p, &n);
+    if (!spots) return;
+    qsort(spots, n, sizeof(Spot), spot_cmp);
+    fprintf(f, "hot spots    (%d locations ran)   count       cycles\n", n);
+    for (int i = 0; i < top && i < n; i++)
+        print_spot(emu, f, &spots[i], total);
+    free(spots);
+}
+
+/* Flat profile: every executed location in address order */
+int profile_dump(const EmulatorState* emu, const char* path)
+{
+    const Profile* p = emu->profile;
+    int bank_size = (int)cart_bank_size(&emu->cart);
+    FILE* f;
+    int n, ok;
+    Spot* spots;
+
+    if (!p) return 0;
+    f = fopen(path, "w");
+    if (!f) return 0;
+
+    fprintf(f, "# rom %016llx %u bytes %s\n", (unsigned long long)emu->cart.rom_hash,
+            (unsigned)emu->cart.rom_size, cart_type_name(&emu->cart));
+    fprintf(f, "# cycles %llu halted %llu wsync %llu\n",
+            (unsigned long long)total_cycles(p), (unsigned long long)p->halted_cycles,
+            (unsigned long long)p->wsyncs);
+    fprintf(f, "# op <opcode> <name> <mode> <count> <cycles>\n");
+    fprintf(f, "# rom <offset> <bank> <address> <count> <cycles>, %d byte banks\n", bank_size);
+    fprintf(f, "# bus <address> <count> <cycles>\n");
+    for (int op = 0; op < 256; op++) {
+        if (!p->op_count[op]) continue;
+        fprintf(f, "op %02X %s %llu %llu\n", op, op_names[op],
+                (unsigned long long)p->op_count[op], (unsigned long long)p->op_cycles[op]);
+    }
+
+    spots = collect(p, &n);
+    ok = spots != NULL;
+    for (int i = 0; ok && i < n; i++) {
+        const Spot* s = &spots[i];
+        if (s->at >= 0)
+            fprintf(f, "rom %05X %d %04X %u %u\n", (unsigned)s->at, s->at / bank_size,
+                    p->rom_pc[s->at], s->count, s->cycles);
+        else
+            fprintf(f, "bus %04X %u %u\n", (unsigned)(-1 - s->at), s->count, s->cycles);
+    }
+    free(spots);
+    return fclose(f) == 0 && ok;
+}
+
+#endif
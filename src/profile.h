@@ -0,0 +1,60 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdio.h>
+#include "types.h"
+
+/* Execution profiler, compiled in with -DCPU_PROFILE (make PROFILE=1).
+ * Without it the hooks below expand to nothing. */
+
+#ifdef CPU_PROFILE
+
+typedef struct Profile {
+    uint64_t  op_count[256];
+    uint64_t  op_cycles[256];
+
+    /* Per ROM byte, so every bank has its own entries */
+    uint32_t  rom_size;
+    uint32_t* rom_count;
+    uint32_t* rom_cycles;
+    uint16_t* rom_pc;       /* address it last ran at */
+
+    /* Code outside the ROM (RIOT RAM, cartridge RAM), per address */
+    uint32_t  bus_count[0x2000];
+    uint32_t  bus_cycles[0x2000];
+
+    uint64_t  halted_cycles;  /* RDY low: WSYNC (or a JAM) */
+    uint64_t  wsyncs;
+
+    /* Instruction being run: ROM offset, or -1 - address off the ROM */
+    int32_t   at;
+    uint16_t  pc;
+} Profile;
+
+int  profile_init(EmulatorState* emu);
+void profile_free(EmulatorState* emu);
+void profile_reset(EmulatorState* emu);
+void profile_fetch(EmulatorState* emu);
+void profile_count(EmulatorState* emu, uint8_t op, int cycles);
+void profile_report(const EmulatorState* emu, FILE* f, int top);
+int  profile_dump(const EmulatorState* emu, const char* path);
+
+#define PROFILE_FETCH(emu) \
+    do { if ((emu)->profile) profile_fetch(emu); } while (0)
+#define PROFILE_OP(emu, op, cycles) \
+    do { if ((emu)->profile) profile_count(emu, op, cycles); } while (0)
+#define PROFILE_HALT(emu, cycles) \
+    do { if ((emu)->profile) (emu)->profile->halted_cycles += (cycles); } while (0)
+#define PROFILE_WSYNC(emu) \
+    do { if ((emu)->profile) (emu)->profile->wsyncs++; } while (0)
+
+#else
+
+#define PROFILE_FETCH(emu)          ((void)0)
+#define PROFILE_OP(emu, op, cycles) ((void)0)
+#define PROFILE_HALT(emu, cycles)   ((void)0)
+#define PROFILE_WSYNC(emu)          ((void)0)
+
+#endif
+
+#endif
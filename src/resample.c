@@ -0,0 +1,120 @@
+#include "resample.h"
+#include <math.h>
+#include <string.h>
+
+/* Polyphase FIR sample rate conversion.
+ *
+ * The filter is a Blackman-windowed sinc of RESAMPLE_TAPS input samples,
+ * precomputed for RESAMPLE_PHASES fractional positions as Q14 integers.
+ * An output sample is the dot product of the taps of its nearest phase
+ * with the last RESAMPLE_TAPS inputs. The history is written twice, at
+ * hpos and hpos + RESAMPLE_TAPS, so the window is always one contiguous
+ * run and the product is a fixed-length loop over two int16 arrays that
+ * the compiler can unroll or vectorize (PMADDWD on x86, PMADDH on the EE).
+ *
+ * The cutoff sits a little below half the lower of the two rates, so
+ * upsampling the TIA's 31.4 kHz only removes the images above it. */
+
+#define TAP_SHIFT  14
+#define CUTOFF     0.45
+
+static void build_taps(Resampler* rs)
+{
+    const double pi = 3.14159265358979323846;
+    int lo = rs->in_rate < rs->out_rate ? rs->in_rate : rs->out_rate;
+    double fc = CUTOFF * lo / rs->in_rate;     /* cycles per input sample */
+    double half = RESAMPLE_TAPS / 2;
+
+    for (int p = 0; p < RESAMPLE_PHASES; p++) {
+        double h[RESAMPLE_TAPS], sum = 0;
+        int isum = 0;
+
+        for (int k = 0; k < RESAMPLE_TAPS; k++) {
+            /* Distance from the output point, which lies p/PHASES past
+             * the middle of the window */
+            double t = k - (half - 1) - (double)p / RESAMPLE_PHASES;
+            double x = 2 * fc * t;
+            double s = t == 0 ? 1.0 : sin(pi * x) / (pi * x);
+            double w = 0.42 + 0.5 * cos(pi * t / half) + 0.08 * cos(2 * pi * t / half);
+            h[k] = s * w;
+            sum += h[k];
+        }
+        /* Unity gain for every phase, rounding error put on the centre tap */
+        for (int k = 0; k < RESAMPLE_TAPS; k++) {
+            rs->taps[p][k] = (int16_t)lrint(h[k] / sum * (1 << TAP_SHIFT));
+            isum += rs->taps[p][k];
+        }
+        rs->taps[p][RESAMPLE_TAPS / 2 - 1] += (1 << TAP_SHIFT) - isum;
+    }
+}
+
+int resample_init(Resampler* rs, int in_rate, int out_rate)
+{
+    memset(rs, 0, sizeof(Resampler));
+    if (in_rate <= 0 || out_rate <= 0) return 0;
+
+    rs->in_rate = in_rate;
+    rs->out_rate = out_rate;
+    rs->step = ((uint64_t)in_rate << 32) / out_rate;
+    build_taps(rs);
+    return 1;
+}
+
+void resample_reset(Resampler* rs)
+{
+    memset(rs->hist, 0, sizeof(rs->hist));
+    rs->hpos = 0;
+    rs->frac = 0;
+}
+
+/* Fine rate control: the filter stays the same, only the step changes */
+void resample_set_ratio(Resampler* rs, double in_per_out)
+{
+    rs->step = (uint64_t)(in_per_out * 4294967296.0);
+}
+
+/* Upper bound of the outputs resample_run gives for in_len inputs */
+int resample_max_out(const Resampler* rs, int in_len)
+{
+    return (int)(((uint64_t)in_len << 32) / rs->step) + 1;
+}
+
+static int16_t dot(const int16_t* x, const int16_t* h)
+{
+    int32_t acc = 0;
+
+    for (int k = 0; k < RESAMPLE_TAPS; k++)
+        acc += (int32_t)x[k] * h[k];
+
+    acc >>= TAP_SHIFT;
+    if (acc > 32767) acc = 32767;
+    if (acc < -32768) acc = -32768;
+    return (int16_t)acc;
+}
+
+int resample_run(Resampler* rs, const int16_t* in, int in_len, int16_t* out)
+{
+    const uint64_t one = (uint64_t)1 << 32;
+    int16_t* hist = rs->hist;
+    uint64_t frac = rs->frac;
+    uint64_t step = rs->step;
+    int hpos = rs->hpos;
+    int n = 0;
+
+    for (int i = 0; i < in_len; i++) {
+        hist[hpos] = hist[hpos + RESAMPLE_TAPS] = in[i];
+        hpos = (hpos + 1) & (RESAMPLE_TAPS - 1);
+
+        /* hist[hpos..hpos+TAPS) now runs oldest to newest */
+        while (frac < one) {
+            int p = (int)(frac >> (32 - RESAMPLE_PHASE_BITS));
+            out[n++] = dot(hist + hpos, rs->taps[p]);
+            frac += step;
+        }
+        frac -= one;
+    }
+
+    rs->frac = frac;
+    rs->hpos = hpos;
+    return n;
+}
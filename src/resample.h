@@ -0,0 +1,26 @@
+#ifndef RESAMPLE_H
+#define RESAMPLE_H
+
+#include <stdint.h>
+
+#define RESAMPLE_TAPS        16
+#define RESAMPLE_PHASE_BITS  6
+#define RESAMPLE_PHASES      (1 << RESAMPLE_PHASE_BITS)
+
+typedef struct {
+    int16_t  taps[RESAMPLE_PHASES][RESAMPLE_TAPS];
+    int16_t  hist[2 * RESAMPLE_TAPS];   /* last inputs, stored twice */
+    int      hpos;
+    uint64_t step;                      /* input samples per output, 32.32 */
+    uint64_t frac;
+    int      in_rate;
+    int      out_rate;
+} Resampler;
+
+int  resample_init(Resampler* rs, int in_rate, int out_rate);
+void resample_reset(Resampler* rs);
+void resample_set_ratio(Resampler* rs, double in_per_out);
+int  resample_max_out(const Resampler* rs, int in_len);
+int  resample_run(Resampler* rs, const int16_t* in, int in_len, int16_t* out);
+
+#endif
@@ -0,0 +1,285 @@
+#include "rewind.h"
+#include "emulator.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Per-frame save states in a fixed memory budget.
+ *
+ * Every `interval` frames a full state (keyframe) is stored; the frames
+ * in between are stored as the XOR against their keyframe, run-length
+ * coded. Between frames only a few RAM bytes, the beam and the cycle
+ * counters change, so a delta is a few dozen bytes, and any frame is
+ * restored from its keyframe and one delta. The input of each frame is
+ * kept next to it, so replaying a frame on the way back shows what was
+ * really on screen.
+ *
+ * Records live back to back in a circular arena. When a new record does
+ * not fit, the oldest ones are dropped, together with any delta left
+ * without its keyframe. */
+
+/* Part of the budget given to the entry index: one entry per 64 bytes
+ * of arena covers the smallest deltas seen in practice */
+#define ARENA_PER_ENTRY 64
+
+/* XOR of src against ref as runs: c < 0x80 is c+1 zero bytes,
+ * c >= 0x80 is (c & 0x7F)+1 literal bytes that follow */
+static size_t delta_encode(const uint8_t* src, const uint8_t* ref, size_t len,
+                           uint8_t* out)
+{
+    size_t i = 0, o = 0;
+
+    while (i < len) {
+        size_t run = 0;
+        while (i + run < len && run < 128 && src[i + run] == ref[i + run]) run++;
+        if (run) {
+            out[o++] = (uint8_t)(run - 1);
+            i += run;
+            continue;
+        }
+        /* Literal run up to the next pair of equal bytes */
+        while (i + run < len && run < 128 &&
+               (src[i + run] != ref[i + run] ||
+                (i + run + 1 < len && src[i + run + 1] != ref[i + run + 1])))
+            run++;
+        out[o++] = (uint8_t)(0x80 | (run - 1));
+        while (run--) {
+            out[o++] = src[i] ^ ref[i];
+            i++;
+        }
+    }
+    return o;
+}
+
+static int delta_decode(const uint8_t* in, size_t in_len, const uint8_t* ref,
+                        uint8_t* dst, size_t len)
+{
+    size_t i = 0, o = 0;
+
+    while (i < in_len) {
+        size_t run = (in[i] & 0x7F) + 1;
+        if (o + run > len) return 0;
+        if (in[i++] & 0x80) {
+            if (i + run > in_len) return 0;
+            while (run--) {
+                dst[o] = ref[o] ^ in[i++];
+                o++;
+            }
+        } else {
+            memcpy(dst + o, ref + o, run);
+            o += run;
+        }
+    }
+    return o == len;
+}
+
+int rewind_init(Rewind* rw, size_t budget, int interval)
+{
+    memset(rw, 0, sizeof(Rewind));
+
+    rw->max_entries = (int)(budget / (ARENA_PER_ENTRY + sizeof(RewindEntry)));
+    rw->arena_size = budget - rw->max_entries * sizeof(RewindEntry);
+    rw->interval = interval > 0 ? interval : 1;
+    if (rw->max_entries < 2 || rw->arena_size > 0xFFFFFFFFu) return 0;
+
+    rw->arena = (uint8_t*)malloc(rw->arena_size);
+    rw->entries = (RewindEntry*)malloc(rw->max_entries * sizeof(RewindEntry));
+    if (!rw->arena || !rw->entries) {
+        rewind_free(rw);
+        return 0;
+    }
+    return 1;
+}
+
+void rewind_free(Rewind* rw)
+{
+    free(rw->arena);
+    free(rw->entries);
+    rw->arena = NULL;
+    rw->entries = NULL;
+    rw->count = 0;
+}
+
+void rewind_clear(Rewind* rw)
+{
+    rw->wpos = 0;
+    rw->tail = 0;
+    rw->count = 0;
+}
+
+static RewindEntry* entry(Rewind* rw, int i)
+{
+    return &rw->entries[(rw->tail + i) % rw->max_entries];
+}
+
+static void drop_oldest(Rewind* rw)
+{
+    do {
+        rw->tail = (rw->tail + 1) % rw->max_entries;
+        rw->count--;
+    } while (rw->count && entry(rw, 0)->key_dist);
+}
+
+/* Make room for len bytes at wpos, dropping whatever is in the way */
+static size_t alloc_record(Rewind* rw, size_t len)
+{
+    if (rw->count == rw->max_entries) drop_oldest(rw);
+
+    if (rw->wpos + len > rw->arena_size) {
+        while (rw->count && entry(rw, 0)->off >= rw->wpos) drop_oldest(rw);
+        rw->wpos = 0;
+    }
+    while (rw->count && entry(rw, 0)->off >= rw->wpos &&
+           entry(rw, 0)->off < rw->wpos + len)
+        drop_oldest(rw);
+
+    return rw->wpos;
+}
+
+/* Joystick and console switch bytes, one bit each */
+static const size_t input_fields[] = {
+    offsetof(EmulatorState, joy0_up),    offsetof(EmulatorState, joy0_down),
+    offsetof(EmulatorState, joy0_left),  offsetof(EmulatorState, joy0_right),
+    offsetof(EmulatorState, joy0_fire),
+    offsetof(EmulatorState, joy1_up),    offsetof(EmulatorState, joy1_down),
+    offsetof(EmulatorState, joy1_left),  offsetof(EmulatorState, joy1_right),
+    offsetof(EmulatorState, joy1_fire),
+    offsetof(EmulatorState, switch_reset), offsetof(EmulatorState, switch_select),
+    offsetof(EmulatorState, switch_color), offsetof(EmulatorState, switch_p0_diff),
+    offsetof(EmulatorState, switch_p1_diff),
+};
+
+#define INPUT_FIELDS ((int)(sizeof(input_fields) / sizeof(input_fields[0])))
+
+static uint16_t pack_input(const EmulatorState* emu)
+{
+    const uint8_t* base = (const uint8_t*)emu;
+    uint16_t bits = 0;
+    int i;
+
+    for (i = 0; i < INPUT_FIELDS; i++)
+        if (base[input_fields[i]]) bits |= 1 << i;
+    return bits;
+}
+
+static void unpack_input(EmulatorState* emu, uint16_t bits)
+{
+    uint8_t* base = (uint8_t*)emu;
+    int i;
+
+    for (i = 0; i < INPUT_FIELDS; i++)
+        base[input_fields[i]] = (bits >> i) & 1;
+}
+
+static void add_record(Rewind* rw, const uint8_t* data, size_t len,
+                       uint32_t key_off, int key_dist, uint16_t input)
+{
+    size_t off = alloc_record(rw, len);
+    RewindEntry* e;
+
+    if (!key_dist) key_off = (uint32_t)off;
+    memcpy(rw->arena + off, data, len);
+    rw->wpos = off + len;
+
+    e = entry(rw, rw->count++);
+    e->off = (uint32_t)off;
+    e->key_off = key_off;
+    e->len = (uint16_t)len;
+    e->key_dist = (uint16_t)key_dist;
+    e->input = input;
+
+    rw->pushed++;
+    rw->pushed_bytes += len;
+}
+
+/* Store the current state as the newest frame */
+int rewind_push(Rewind* rw, const EmulatorState* emu)
+{
+    size_t size = savestate_save(emu, rw->state, sizeof(rw->state));
+    uint16_t input = pack_input(emu);
+    RewindEntry* top;
+
+    if (!size || size > rw->arena_size) return 0;
+    if (size != rw->state_size) {
+        /* Another ROM: old frames cannot be restored anyway */
+        rewind_clear(rw);
+        rw->state_size = size;
+    }
+
+    top = rw->count ? entry(rw, rw->count - 1) : NULL;
+    if (top && top->key_dist + 1 < rw->interval) {
+        uint32_t key_off = top->key_off;
+        int dist = top->key_dist + 1;
+        size_t len = delta_encode(rw->state, rw->arena + key_off, size, rw->scratch);
+
+        alloc_record(rw, len);
+        /* The keyframe went with the oldest frames: start a new one */
+        if (rw->count) {
+            add_record(rw, rw->scratch, len, key_off, dist, input);
+            return 1;
+        }
+    }
+    add_record(rw, rw->state, size, 0, 0, input);
+    return 1;
+}
+
+/* Load the newest frame and its input, leaving it in the buffer */
+int rewind_peek(Rewind* rw, EmulatorState* emu)
+{
+    RewindEntry* e;
+    const uint8_t* state;
+
+    if (!rw->count) return 0;
+    e = entry(rw, rw->count - 1);
+    state = rw->arena + e->off;
+    if (e->key_dist) {
+        if (!delta_decode(state, e->len, rw->arena + e->key_off,
+                          rw->state, rw->state_size))
+            return 0;
+        state = rw->state;
+    }
+    if (!savestate_load(emu, state, rw->state_size)) return 0;
+    unpack_input(emu, e->input);
+    return 1;
+}
+
+/* Forget the newest frame */
+int rewind_pop(Rewind* rw)
+{
+    if (!rw->count) return 0;
+    rw->count--;
+    if (rw->count) {
+        RewindEntry* top = entry(rw, rw->count - 1);
+        rw->wpos = top->off + top->len;
+    }
+    return 1;
+}
+
+/* emu_run_frame() with history. Forward: remember the state the frame
+ * starts from, then run it. Back: drop the newest frame and replay the
+ * one before it, so the screen shows the previous frame. Returns 0 when
+ * there is nothing left to rewind to. */
+int rewind_run_frame(Rewind* rw, EmulatorState* emu, int back)
+{
+    if (!back) {
+        rewind_push(rw, emu);
+        emu_run_frame(emu);
+        return 1;
+    }
+
+    if (rw->count < 2) return 0;
+    rewind_pop(rw);
+    if (!rewind_peek(rw, emu)) return 0;
+    emu_run_frame(emu);
+    return 1;
+}
+
+size_t rewind_bytes_used(const Rewind* rw)
+{
+    size_t used = 0;
+    int i;
+
+    for (i = 0; i < rw->count; i++)
+        used += rw->entries[(rw->tail + i) % rw->max_entries].len;
+    return used;
+}
@@ -0,0 +1,45 @@
+#ifndef REWIND_H
+#define REWIND_H
+
+#include <stddef.h>
+#include "types.h"
+#include "savestate.h"
+
+typedef struct {
+    uint32_t off;       /* record position in the arena */
+    uint32_t key_off;   /* keyframe this delta is against (self if key) */
+    uint16_t len;
+    uint16_t key_dist;  /* frames since the keyframe, 0 = keyframe */
+    uint16_t input;     /* joysticks and switches the frame ran with */
+} RewindEntry;
+
+typedef struct {
+    uint8_t*     arena;
+    size_t       arena_size;
+    size_t       wpos;
+
+    RewindEntry* entries;   /* ring, oldest at tail */
+    int          max_entries;
+    int          tail;
+    int          count;
+
+    int          interval;  /* frames between keyframes */
+    size_t       state_size;
+    uint8_t      state[SAVESTATE_MAX_SIZE];
+    uint8_t      scratch[SAVESTATE_MAX_SIZE + SAVESTATE_MAX_SIZE / 128 + 1];
+
+    /* Totals since init, for sizing */
+    uint64_t     pushed;
+    uint64_t     pushed_bytes;
+} Rewind;
+
+int  rewind_init(Rewind* rw, size_t budget, int interval);
+void rewind_free(Rewind* rw);
+void rewind_clear(Rewind* rw);
+int  rewind_push(Rewind* rw, const EmulatorState* emu);
+int  rewind_peek(Rewind* rw, EmulatorState* emu);
+int  rewind_pop(Rewind* rw);
+int  rewind_run_frame(Rewind* rw, EmulatorState* emu, int back);
+size_t rewind_bytes_used(const Rewind* rw);
+
+#endif
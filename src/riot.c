@@ -5,8 +5,52 @@ void riot_init(EmulatorState* emu)
 {
     memset(&emu->riot, 0, sizeof(RIOT));
     emu->riot.portb = 0x3F; /* Default: color TV, both A difficulty */
-    emu->riot.timer_value = 1024;
-    emu->riot.timer_interval = 1024;
+    emu->riot.timer_shift = 10;
+    emu->riot.timer_start = emu->cpu.cycles;
+    emu->riot.timer_read = emu->cpu.cycles;
+}
+
+/* Cycles after the write at which the timer wraps from 0 to 0xFF. It
+ * decrements one cycle after the write and then every interval. */
+static uint32_t underflow_at(const RIOT* riot)
+{
+    return ((uint32_t)riot->timer_value << riot->timer_shift) + 1;
+}
+
+/* INTIM at cpu.cycles: after the underflow it counts down every cycle */
+static uint8_t timer_intim(EmulatorState* emu)
+{
+    RIOT* riot = &emu->riot;
+    uint64_t elapsed = emu->cpu.cycles - riot->timer_start;
+    uint32_t under = underflow_at(riot);
+
+    if (elapsed == 0) return riot->timer_value;
+    if (elapsed < under)
+        return riot->timer_value - 1 - (uint8_t)((elapsed - 1) >> riot->timer_shift);
+    return (uint8_t)(0xFF - (elapsed - under));
+}
+
+/* Timer flag: set by every wrap to 0xFF since the last INTIM read or
+ * timer write */
+static int timer_flag(EmulatorState* emu)
+{
+    RIOT* riot = &emu->riot;
+    uint64_t now = emu->cpu.cycles;
+    uint64_t first = riot->timer_start + underflow_at(riot);
+
+    if (now < first) return 0;
+    uint64_t last = now - ((now - first) & 0xFF);
+    return last > riot->timer_read;
+}
+
+int riot_cycles_to_underflow(EmulatorState* emu)
+{
+    RIOT* riot = &emu->riot;
+    uint64_t elapsed = emu->cpu.cycles - riot->timer_start;
+    uint32_t under = underflow_at(riot);
+
+    if (elapsed < under) return (int)(under - elapsed);
+    return 256 - (int)((elapsed - under) & 0xFF);
 }
 
 void riot_reset(EmulatorState* emu)
@@ -68,14 +112,13 @@ uint8_t riot_read(EmulatorState* emu, uint16_t addr)
         case 0x03: /* SWBCNT */
             return riot->ddrb;
         case 0x04: /* INTIM */
-            riot->timer_underflow = 0;
-            return (uint8_t)(riot->timer_value >> 10);
-        case 0x05: /* INSTAT (timer status) */
         {
-            uint8_t ret = 0;
-            if (riot->timer_underflow) ret |= 0xC0;
+            uint8_t ret = timer_intim(emu);
+            riot->timer_read = emu->cpu.cycles; /* clears the flag */
             return ret;
         }
+        case 0x05: /* INSTAT (timer status) */
+            return timer_flag(emu) ? 0x80 : 0x00;
         default:
             return 0;
     }
@@ -92,30 +135,13 @@ void riot_write(EmulatorState* emu, uint16_t addr, uint8_t value)
         return;
     }
 
-    /* Timer registers */
+    /* Timer registers: TIM1T, TIM8T, TIM64T, T1024T */
     if (addr & 0x10) {
-        switch (addr & 0x03) {
-            case 0x00: /* TIM1T  - 1 cycle */
-                riot->timer_value = value * 1;
-                riot->timer_interval = 1;
-                riot->timer_underflow = 0;
-                break;
-            case 0x01: /* TIM8T  - 8 cycles */
-                riot->timer_value = value * 8;
-                riot->timer_interval = 8;
-                riot->timer_underflow = 0;
-                break;
-            case 0x02: /* TIM64T - 64 cycles */
-                riot->timer_value = value * 64;
-                riot->timer_interval = 64;
-                riot->timer_underflow = 0;
-                break;
-            case 0x03: /* T1024T - 1024 cycles */
-                riot->timer_value = value * 1024;
-                riot->timer_interval = 1024;
-                riot->timer_underflow = 0;
-                break;
-        }
+        static const uint8_t shift[4] = { 0, 3, 6, 10 };
+        riot->timer_value = value;
+        riot->timer_shift = shift[addr & 0x03];
+        riot->timer_start = emu->cpu.cycles;
+        riot->timer_read = emu->cpu.cycles;
         return;
     }
 
@@ -126,17 +152,3 @@ void riot_write(EmulatorState* emu, uint16_t addr, uint8_t value)
         case 0x03: riot->ddrb = value; break;
     }
 }
-
-void riot_tick(EmulatorState* emu, int cycles)
-{
-    RIOT* riot = &emu->riot;
-
-    if (riot->timer_value > 0) {
-        if ((uint32_t)cycles >= riot->timer_value) {
-            riot->timer_value = 0;
-            riot->timer_underflow = 1;
-        } else {
-            riot->timer_value -= cycles;
-        }
-    }
-}
@@ -7,6 +7,6 @@ void    riot_init(EmulatorState* emu);
 void    riot_reset(EmulatorState* emu);
 uint8_t riot_read(EmulatorState* emu, uint16_t addr);
 void    riot_write(EmulatorState* emu, uint16_t addr, uint8_t value);
-void    riot_tick(EmulatorState* emu, int cycles);
+int     riot_cycles_to_underflow(EmulatorState* emu);
 
 #endif
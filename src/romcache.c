@@ -0,0 +1,88 @@
+#include "romcache.h"
+#include "hash.h"
+#include "romfile.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* ROM images keyed by content hash.
+ *
+ * Opening a file that holds the same bytes as an image already in the
+ * cache (same file again, or a copy under another name) returns that
+ * image with one more reference, so any number of cartridges running one
+ * game share a single copy of its ROM. The image is freed with its last
+ * reference. Images are never written after loading; the cache itself
+ * and the reference counts are not locked, so open/retain/release belong
+ * to one thread (batch workers borrow images the main thread holds). */
+
+static RomImage* cache;
+
+/* Image with the contents of filename, one new reference to it */
+RomImage* romcache_open(const char* filename)
+{
+    RomFile file;
+    uint64_t hash;
+    RomImage* img;
+
+    if (!romfile_open(&file, filename, CART_MAX_ROM_SIZE)) return NULL;
+    hash = hash64(file.data, file.size);
+
+    for (img = cache; img; img = img->next) {
+        if (img->hash == hash && img->size == file.size &&
+            !memcmp(img->data, file.data, file.size)) {
+            romfile_close(&file);
+            img->refs++;
+            return img;
+        }
+    }
+
+    img = (RomImage*)malloc(sizeof(RomImage));
+    if (!img) {
+        romfile_close(&file);
+        return NULL;
+    }
+    img->file = file;
+    img->data = file.data;
+    img->size = file.size;
+    img->hash = hash;
+    md5(img->data, img->size, img->md5);
+    img->refs = 1;
+    img->next = cache;
+    cache = img;
+    return img;
+}
+
+void romcache_retain(RomImage* img)
+{
+    img->refs++;
+}
+
+void romcache_release(RomImage* img)
+{
+    RomImage** link;
+
+    if (!img || --img->refs > 0) return;
+
+    for (link = &cache; *link; link = &(*link)->next) {
+        if (*link == img) {
+            *link = img->next;
+            break;
+        }
+    }
+    romfile_close(&img->file);
+    free(img);
+}
+
+int romcache_count(void)
+{
+    int n = 0;
+    for (RomImage* img = cache; img; img = img->next) n++;
+    return n;
+}
+
+/* ROM bytes held by the cache */
+size_t romcache_bytes(void)
+{
+    size_t n = 0;
+    for (RomImage* img = cache; img; img = img->next) n += img->size;
+    return n;
+}
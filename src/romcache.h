@@ -0,0 +1,13 @@
+#ifndef ROMCACHE_H
+#define ROMCACHE_H
+
+#include <stddef.h>
+#include "types.h"
+
+RomImage* romcache_open(const char* filename);
+void      romcache_retain(RomImage* img);
+void      romcache_release(RomImage* img);
+int       romcache_count(void);
+size_t    romcache_bytes(void);
+
+#endif
@@ -0,0 +1,38 @@
+#include "romdb.h"
+#include <stddef.h>
+#include <string.h>
+
+/* Known ROMs by MD5, the digest other 2600 databases (Stella's) list
+ * games by, so entries can be taken from them without the image at hand.
+ * The ROM cache computes the digest once per image; a lookup is a binary
+ * search over the table. ROMs missing from it fall back to
+ * cart_detect(). romdb_table.h is generated by tools/romdb_gen and
+ * sorted by digest. */
+
+static const RomDbEntry table[] = {
+#include "romdb_table.h"
+    /* Sentinel: keeps the array valid with an empty table */
+    { { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF }, 0, 0, 0, 0 }
+};
+
+#define TABLE_SIZE ((int)(sizeof(table) / sizeof(table[0])) - 1)
+
+const RomDbEntry* romdb_lookup(const uint8_t md5[MD5_SIZE], uint32_t size)
+{
+    int lo = 0, hi = TABLE_SIZE;
+
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (memcmp(table[mid].md5, md5, MD5_SIZE) < 0) lo = mid + 1;
+        else                                            hi = mid;
+    }
+    if (lo < TABLE_SIZE && !memcmp(table[lo].md5, md5, MD5_SIZE) && table[lo].size == size)
+        return &table[lo];
+    return NULL;
+}
+
+int romdb_count(void)
+{
+    return TABLE_SIZE;
+}
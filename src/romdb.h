@@ -0,0 +1,18 @@
+#ifndef ROMDB_H
+#define ROMDB_H
+
+#include "types.h"
+#include "hash.h"
+
+typedef struct {
+    uint8_t  md5[MD5_SIZE]; /* of the whole image */
+    uint32_t size;
+    uint8_t  type;          /* CartType */
+    uint8_t  superchip;
+    uint8_t  tv;            /* TvFormat */
+} RomDbEntry;
+
+const RomDbEntry* romdb_lookup(const uint8_t md5[MD5_SIZE], uint32_t size);
+int romdb_count(void);
+
+#endif
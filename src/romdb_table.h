@@ -0,0 +1,23 @@
+/* Generated by tools/romdb_gen - do not edit.
+ * { md5, size, CartType, superchip, TvFormat } */
+    /* Frogger II - Threeedeep! (1984) (Parker Bros) */
+    { { 0x08,0x1e,0x2c,0x11,0x4c,0x9c,0x20,0xb6,0x1a,0xcf,0x25,0xfc,0x95,0xc7,0x1b,0xf4 },
+        8192, CART_E0, 0, TV_NTSC },
+    /* Montezuma's Revenge (1984) (Parker Bros) */
+    { { 0x33,0x47,0xa6,0xdd,0x59,0x04,0x9b,0x15,0xa3,0x83,0x94,0xaa,0x2d,0xaf,0xa5,0x85 },
+        8192, CART_E0, 0, TV_NTSC },
+    /* Robot Tank (1983) (Activision) */
+    { { 0x4f,0x61,0x8c,0x24,0x29,0x13,0x8e,0x02,0x80,0x96,0x91,0x93,0xed,0x6c,0x10,0x7e },
+        8192, CART_FE, 0, TV_NTSC },
+    /* Bump 'n' Jump (1983) (M Network) */
+    { { 0x76,0xf5,0x3a,0xbb,0xbf,0x39,0xa0,0x06,0x3f,0x24,0x03,0x6d,0x6e,0xe0,0x96,0x8a },
+       16384, CART_E7, 0, TV_NTSC },
+    /* Decathlon (1983) (Activision) (PAL) */
+    { { 0x88,0x32,0x58,0xdc,0xd6,0x8c,0xef,0xc6,0xcd,0x4d,0x40,0xb1,0x18,0x51,0x16,0xdc },
+        8192, CART_FE, 0, TV_PAL },
+    /* Decathlon (1983) (Activision) */
+    { { 0xac,0x7c,0x22,0x60,0x37,0x89,0x75,0x61,0x41,0x92,0xca,0x2b,0xc3,0xd2,0x0e,0x0b },
+        8192, CART_FE, 0, TV_NTSC },
+    /* Robot Tank (1983) (Activision) (PAL) */
+    { { 0xfb,0xb0,0x15,0x1e,0xa2,0x10,0x8e,0x33,0xb2,0xdb,0xaa,0xe1,0x4a,0x18,0x31,0xdd },
+        8192, CART_FE, 0, TV_PAL },
@@ -0,0 +1,96 @@
+#include "romfile.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Read-only view of a whole ROM file.
+ *
+ * Where the OS can map files (Linux, macOS) the file is mapped read-only
+ * and data points straight into the page cache: nothing is copied and
+ * no heap is used, and copies of the same file opened by several
+ * processes share one set of pages. Loading still reads every page once,
+ * because the ROM cache hashes the whole image and cart_detect() scans
+ * it, so mapping saves the copy, not the I/O. Elsewhere, such as the PS2
+ * mass: and host: devices, the file is read into a malloc'd buffer.
+ * Either way the caller sees the same const bytes until romfile_close(). */
+
+#if (defined(__linux__) || defined(__APPLE__)) && !defined(ROMFILE_NO_MMAP)
+#define ROMFILE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static int read_whole(RomFile* f, const char* filename, uint32_t max_size)
+{
+    FILE* fp = fopen(filename, "rb");
+    uint8_t* data;
+    long n;
+
+    if (!fp) return 0;
+    fseek(fp, 0, SEEK_END);
+    n = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    if (n <= 0 || (unsigned long)n > max_size) {
+        fclose(fp);
+        return 0;
+    }
+
+    data = (uint8_t*)malloc(n);
+    if (!data || (long)fread(data, 1, n, fp) != n) {
+        free(data);
+        fclose(fp);
+        return 0;
+    }
+    fclose(fp);
+
+    f->data = data;
+    f->size = (uint32_t)n;
+    f->mapped = 0;
+    return 1;
+}
+
+int romfile_open(RomFile* f, const char* filename, uint32_t max_size)
+{
+    f->data = NULL;
+    f->size = 0;
+    f->mapped = 0;
+
+#ifdef ROMFILE_MMAP
+    {
+        int fd = open(filename, O_RDONLY);
+        struct stat st;
+        void* p;
+
+        if (fd < 0) return 0;
+        if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) ||
+            st.st_size <= 0 || (uint64_t)st.st_size > max_size) {
+            close(fd);
+            return 0;
+        }
+        p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (p != MAP_FAILED) {
+            f->data = (const uint8_t*)p;
+            f->size = (uint32_t)st.st_size;
+            f->mapped = 1;
+            return 1;
+        }
+        /* Filesystems without mmap support: fall back to reading */
+    }
+#endif
+    return read_whole(f, filename, max_size);
+}
+
+void romfile_close(RomFile* f)
+{
+#ifdef ROMFILE_MMAP
+    if (f->mapped) munmap((void*)f->data, f->size);
+    else
+#endif
+    free((void*)f->data);
+    f->data = NULL;
+    f->size = 0;
+    f->mapped = 0;
+}
@@ -0,0 +1,9 @@
+#ifndef ROMFILE_H
+#define ROMFILE_H
+
+#include "types.h"
+
+int  romfile_open(RomFile* f, const char* filename, uint32_t max_size);
+void romfile_close(RomFile* f);
+
+#endif
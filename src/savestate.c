@@ -0,0 +1,216 @@
+#include "savestate.h"
+#include "tia.h"
+#include "cartridge.h"
+#include <string.h>
+
+/* Layout (little endian, no padding):
+ *
+ *   "A26S" version:8 rom_hash:64
+ *   CPU, TIA, RIOT, RAM, cartridge bank + RAM, scheduler
+ *
+ * The body is the same field list walked in both directions by
+ * state_io(), so save and load cannot drift apart. Only emulated state
+ * goes in: the framebuffer, object masks, palette and input are either
+ * rebuilt or belong to the frontend. */
+
+static const uint8_t magic[4] = { 'A', '2', '6', 'S' };
+
+#define HEADER_SIZE 13
+
+typedef struct {
+    uint8_t* buf;   /* NULL: only count bytes */
+    size_t   pos;
+    int      load;
+} Stream;
+
+static void io_bytes(Stream* s, void* p, size_t n)
+{
+    if (s->buf) {
+        if (s->load) memcpy(p, s->buf + s->pos, n);
+        else         memcpy(s->buf + s->pos, p, n);
+    }
+    s->pos += n;
+}
+
+static void io_u8(Stream* s, uint8_t* v)
+{
+    io_bytes(s, v, 1);
+}
+
+/* n-byte little endian integer */
+static void io_le(Stream* s, uint64_t* v, int n)
+{
+    uint8_t b[8];
+    int i;
+
+    for (i = 0; i < n; i++) b[i] = (uint8_t)(*v >> (i * 8));
+    io_bytes(s, b, n);
+    if (s->load && s->buf) {
+        *v = 0;
+        for (i = 0; i < n; i++) *v |= (uint64_t)b[i] << (i * 8);
+    }
+}
+
+static void io_u16(Stream* s, uint16_t* v)
+{
+    uint64_t x = *v;
+    io_le(s, &x, 2);
+    *v = (uint16_t)x;
+}
+
+static void io_u32(Stream* s, uint32_t* v)
+{
+    uint64_t x = *v;
+    io_le(s, &x, 4);
+    *v = (uint32_t)x;
+}
+
+static void io_u64(Stream* s, uint64_t* v)
+{
+    io_le(s, v, 8);
+}
+
+static void io_i16(Stream* s, int16_t* v)
+{
+    uint16_t x = (uint16_t)*v;
+    io_u16(s, &x);
+    *v = (int16_t)x;
+}
+
+static void io_int(Stream* s, int* v)
+{
+    uint32_t x = (uint32_t)*v;
+    io_u32(s, &x);
+    *v = (int)x;
+}
+
+static void state_io(Stream* s, EmulatorState* emu)
+{
+    CPU6507* c = &emu->cpu;
+    TIA* t = &emu->tia;
+    RIOT* r = &emu->riot;
+    uint16_t cx;
+
+    io_u8(s, &c->A);
+    io_u8(s, &c->X);
+    io_u8(s, &c->Y);
+    io_u8(s, &c->SP);
+    io_u16(s, &c->PC);
+    io_u8(s, &c->P);
+    io_u64(s, &c->cycles);
+    io_u64(s, &c->instructions);
+    io_int(s, &c->halted);
+
+    /* vsync .. hmbl are consecutive bytes */
+    io_bytes(s, &t->vsync, &t->hmbl + 1 - &t->vsync);
+    io_i16(s, &t->posp0);
+    io_i16(s, &t->posp1);
+    io_i16(s, &t->posm0);
+    io_i16(s, &t->posm1);
+    io_i16(s, &t->posbl);
+    /* cx with the deferred collisions folded in */
+    cx = s->load ? 0 : tia_collisions(emu);
+    io_u16(s, &cx);
+    if (s->load) t->cx = cx;
+    io_u8(s, &t->vdelp0);
+    io_u8(s, &t->vdelp1);
+    io_u8(s, &t->vdelbl);
+    io_u8(s, &t->resmp0);
+    io_u8(s, &t->resmp1);
+    io_int(s, &t->scanline);
+    io_int(s, &t->dot);
+    io_int(s, &t->frame_done);
+    io_int(s, &t->render_dot);
+    io_u8(s, &t->audc0);
+    io_u8(s, &t->audc1);
+    io_u8(s, &t->audf0);
+    io_u8(s, &t->audf1);
+    io_u8(s, &t->audv0);
+    io_u8(s, &t->audv1);
+    for (int i = 0; i < 2; i++) {
+        AudioChannel* ch = &t->aud[i];
+        io_u8(s, &ch->div);
+        io_u8(s, &ch->noise);
+        io_u8(s, &ch->pulse);
+        io_u8(s, &ch->clock_en);
+        io_u8(s, &ch->noise_fb);
+        io_u8(s, &ch->pulse_hold);
+        io_u8(s, &ch->noise_bit4);
+    }
+    io_int(s, &t->audio_clock);
+    io_u8(s, &t->inpt4);
+    io_u8(s, &t->inpt5);
+
+    io_u8(s, &r->ddra);
+    io_u8(s, &r->ddrb);
+    io_u8(s, &r->porta);
+    io_u8(s, &r->portb);
+    io_u64(s, &r->timer_start);
+    io_u64(s, &r->timer_read);
+    io_u8(s, &r->timer_value);
+    io_u8(s, &r->timer_shift);
+
+    io_bytes(s, emu->ram, sizeof(emu->ram));
+
+    io_bytes(s, emu->cart.bank, sizeof(emu->cart.bank));
+    io_bytes(s, emu->cart.extra_ram, cart_ram_size(&emu->cart));
+
+    io_u64(s, &emu->sync_cycles);
+}
+
+size_t savestate_size(const EmulatorState* emu)
+{
+    Stream s = { NULL, 0, 0 };
+
+    state_io(&s, (EmulatorState*)emu);
+    return HEADER_SIZE + s.pos;
+}
+
+/* Returns the number of bytes written, 0 if buf is too small */
+size_t savestate_save(const EmulatorState* emu, uint8_t* buf, size_t cap)
+{
+    Stream s;
+    uint8_t version = SAVESTATE_VERSION;
+    uint64_t hash = emu->cart.rom_hash;
+    size_t size = savestate_size(emu);
+
+    if (cap < size) return 0;
+
+    s.buf = buf;
+    s.pos = 0;
+    s.load = 0;
+    io_bytes(&s, (void*)magic, 4);
+    io_u8(&s, &version);
+    io_u64(&s, &hash);
+    state_io(&s, (EmulatorState*)emu);
+    return s.pos;
+}
+
+/* Rejects states from another format version or ROM, or of the wrong
+ * size, without touching emu */
+int savestate_load(EmulatorState* emu, const uint8_t* buf, size_t len)
+{
+    Stream s = { (uint8_t*)buf, 0, 1 };
+    uint8_t version = 0;
+    uint64_t hash = 0;
+    uint8_t m[4];
+
+    if (len < HEADER_SIZE || len != savestate_size(emu)) return 0;
+
+    io_bytes(&s, m, 4);
+    io_u8(&s, &version);
+    io_u64(&s, &hash);
+    if (memcmp(m, magic, 4) || version != SAVESTATE_VERSION ||
+        hash != emu->cart.rom_hash)
+        return 0;
+
+    state_io(&s, emu);
+
+    for (int i = 0; i < CART_SLOTS; i++)
+        if (emu->cart.bank[i] >= emu->cart.num_banks)
+            emu->cart.bank[i] = (uint8_t)(emu->cart.num_banks - 1);
+    emu->frame_ready = 0;
+    tia_invalidate(emu);
+    cart_map(emu);
+    return 1;
+}
@@ -0,0 +1,14 @@
+#ifndef SAVESTATE_H
+#define SAVESTATE_H
+
+#include <stddef.h>
+#include "types.h"
+
+#define SAVESTATE_VERSION  3
+#define SAVESTATE_MAX_SIZE 4096
+
+size_t savestate_size(const EmulatorState* emu);
+size_t savestate_save(const EmulatorState* emu, uint8_t* buf, size_t cap);
+int    savestate_load(EmulatorState* emu, const uint8_t* buf, size_t len);
+
+#endif
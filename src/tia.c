@@ -1,84 +1,106 @@
 #include "tia.h"
+#include "profile.h"
 #include <string.h>
 
-/* Full NTSC palette (128 colors, luminance pairs) */
-static const uint32_t ntsc_palette[256] = {
-    /* 0x00 */ 0x000000, 0x000000, 0x4a4a4a, 0x4a4a4a,
-    /* 0x04 */ 0x6f6f6f, 0x6f6f6f, 0x8e8e8e, 0x8e8e8e,
-    /* 0x08 */ 0xaaaaaa, 0xaaaaaa, 0xc0c0c0, 0xc0c0c0,
-    /* 0x0C */ 0xd6d6d6, 0xd6d6d6, 0xececec, 0xececec,
-    /* 0x10 */ 0x484800, 0x484800, 0x69690f, 0x69690f,
-    /* 0x14 */ 0x86861d, 0x86861d, 0xa2a22a, 0xa2a22a,
-    /* 0x18 */ 0xbbbb35, 0xbbbb35, 0xd2d240, 0xd2d240,
-    /* 0x1C */ 0xe8e84a, 0xe8e84a, 0xfcfc54, 0xfcfc54,
-    /* 0x20 */ 0x7c2c00, 0x7c2c00, 0x904811, 0x904811,
-    /* 0x24 */ 0xa26221, 0xa26221, 0xb47a30, 0xb47a30,
-    /* 0x28 */ 0xc3903d, 0xc3903d, 0xd2a44a, 0xd2a44a,
-    /* 0x2C */ 0xdfb755, 0xdfb755, 0xecc860, 0xecc860,
-    /* 0x30 */ 0x901c00, 0x901c00, 0xa33915, 0xa33915,
-    /* 0x34 */ 0xb55328, 0xb55328, 0xc56b3a, 0xc56b3a,
-    /* 0x38 */ 0xd5804a, 0xd5804a, 0xe39359, 0xe39359,
-    /* 0x3C */ 0xf0a567, 0xf0a567, 0xfcb574, 0xfcb574,
-    /* 0x40 */ 0x940000, 0x940000, 0xa71a1a, 0xa71a1a,
-    /* 0x44 */ 0xb83232, 0xb83232, 0xc84848, 0xc84848,
-    /* 0x48 */ 0xd65c5c, 0xd65c5c, 0xe46e6e, 0xe46e6e,
-    /* 0x4C */ 0xf08080, 0xf08080, 0xfc9090, 0xfc9090,
-    /* 0x50 */ 0x840064, 0x840064, 0x97197a, 0x97197a,
-    /* 0x54 */ 0xa8308f, 0xa8308f, 0xb846a2, 0xb846a2,
-    /* 0x58 */ 0xc659b3, 0xc659b3, 0xd46cc3, 0xd46cc3,
-    /* 0x5C */ 0xe07cd2, 0xe07cd2, 0xec8ce0, 0xec8ce0,
-    /* 0x60 */ 0x500084, 0x500084, 0x68199a, 0x68199a,
-    /* 0x64 */ 0x7d30ad, 0x7d30ad, 0x9246c0, 0x9246c0,
-    /* 0x68 */ 0xa459d0, 0xa459d0, 0xb56ce0, 0xb56ce0,
-    /* 0x6C */ 0xc57cee, 0xc57cee, 0xd48cfc, 0xd48cfc,
-    /* 0x70 */ 0x140090, 0x140090, 0x331aa3, 0x331aa3,
-    /* 0x74 */ 0x4e32b5, 0x4e32b5, 0x6848c6, 0x6848c6,
-    /* 0x78 */ 0x7f5cd5, 0x7f5cd5, 0x956ee3, 0x956ee3,
-    /* 0x7C */ 0xa980f0, 0xa980f0, 0xbc90fc, 0xbc90fc,
-    /* 0x80 */ 0x000094, 0x000094, 0x181aa7, 0x181aa7,
-    /* 0x84 */ 0x2d32b8, 0x2d32b8, 0x4248c8, 0x4248c8,
-    /* 0x88 */ 0x545cd6, 0x545cd6, 0x656ee4, 0x656ee4,
-    /* 0x8C */ 0x7580f0, 0x7580f0, 0x8490fc, 0x8490fc,
-    /* 0x90 */ 0x001c88, 0x001c88, 0x183b9d, 0x183b9d,
-    /* 0x94 */ 0x2d57b0, 0x2d57b0, 0x4272c2, 0x4272c2,
-    /* 0x98 */ 0x548ad2, 0x548ad2, 0x65a0e1, 0x65a0e1,
-    /* 0x9C */ 0x75b5ef, 0x75b5ef, 0x84c8fc, 0x84c8fc,
-    /* 0xA0 */ 0x003064, 0x003064, 0x185080, 0x185080,
-    /* 0xA4 */ 0x2d6d98, 0x2d6d98, 0x4288b0, 0x4288b0,
-    /* 0xA8 */ 0x54a0c5, 0x54a0c5, 0x65b7d9, 0x65b7d9,
-    /* 0xAC */ 0x75cceb, 0x75cceb, 0x84e0fc, 0x84e0fc,
-    /* 0xB0 */ 0x004400, 0x004400, 0x1a661a, 0x1a661a,
-    /* 0xB4 */ 0x328432, 0x328432, 0x48a048, 0x48a048,
-    /* 0xB8 */ 0x5cb85c, 0x5cb85c, 0x6ece6e, 0x6ece6e,
-    /* 0xBC */ 0x80e280, 0x80e280, 0x90f490, 0x90f490,
-    /* 0xC0 */ 0x143c00, 0x143c00, 0x355f18, 0x355f18,
-    /* 0xC4 */ 0x527e2d, 0x527e2d, 0x6e9c42, 0x6e9c42,
-    /* 0xC8 */ 0x87b754, 0x87b754, 0x9ed065, 0x9ed065,
-    /* 0xCC */ 0xb4e775, 0xb4e775, 0xc8fc84, 0xc8fc84,
-    /* 0xD0 */ 0x303800, 0x303800, 0x505916, 0x505916,
-    /* 0xD4 */ 0x6d762b, 0x6d762b, 0x88923e, 0x88923e,
-    /* 0xD8 */ 0xa0ab4f, 0xa0ab4f, 0xb7c25f, 0xb7c25f,
-    /* 0xDC */ 0xccd86e, 0xccd86e, 0xe0ec7c, 0xe0ec7c,
-    /* 0xE0 */ 0x482c00, 0x482c00, 0x694d14, 0x694d14,
-    /* 0xE4 */ 0x866a26, 0x866a26, 0xa28638, 0xa28638,
-    /* 0xE8 */ 0xbb9f47, 0xbb9f47, 0xd2b656, 0xd2b656,
-    /* 0xEC */ 0xe8cc63, 0xe8cc63, 0xfce070, 0xfce070,
-    /* 0xF0 */ 0x681400, 0x681400, 0x833915, 0x833915,
-    /* 0xF4 */ 0x9b5b28, 0x9b5b28, 0xb07b3a, 0xb07b3a,
-    /* 0xF8 */ 0xc4984a, 0xc4984a, 0xd6b359, 0xd6b359,
-    /* 0xFC */ 0xe8cc67, 0xe8cc67, 0xf8e474, 0xf8e474,
+/* Framebuffer value of TIA color register c */
+#ifdef FB_INDEXED
+#define PIXEL(emu, c) ((Pixel)((c) & 0xFE))
+#else
+#define PIXEL(emu, c) ((emu)->palette[(c) & 0xFE])
+#endif
+
+/* Objects of the span renderer, in collision/priority code order */
+enum { OBJ_P0, OBJ_P1, OBJ_M0, OBJ_M1, OBJ_BL, OBJ_PF, OBJ_COUNT };
+
+#define DIRTY(o)  (1 << (o))
+#define DIRTY_ALL ((1 << OBJ_COUNT) - 1)
+
+/* Object masks invalidated by each register write */
+static const uint8_t write_dirty[0x40] = {
+    [0x04] = DIRTY(OBJ_P0) | DIRTY(OBJ_M0),          /* NUSIZ0 */
+    [0x05] = DIRTY(OBJ_P1) | DIRTY(OBJ_M1),          /* NUSIZ1 */
+    [0x0A] = DIRTY(OBJ_PF) | DIRTY(OBJ_BL),          /* CTRLPF */
+    [0x0B] = DIRTY(OBJ_P0),                          /* REFP0 */
+    [0x0C] = DIRTY(OBJ_P1),                          /* REFP1 */
+    [0x0D] = DIRTY(OBJ_PF),                          /* PF0 */
+    [0x0E] = DIRTY(OBJ_PF),                          /* PF1 */
+    [0x0F] = DIRTY(OBJ_PF),                          /* PF2 */
+    [0x10] = DIRTY(OBJ_P0),                          /* RESP0 */
+    [0x11] = DIRTY(OBJ_P1),                          /* RESP1 */
+    [0x12] = DIRTY(OBJ_M0),                          /* RESM0 */
+    [0x13] = DIRTY(OBJ_M1),                          /* RESM1 */
+    [0x14] = DIRTY(OBJ_BL),                          /* RESBL */
+    [0x1B] = DIRTY(OBJ_P0),                          /* GRP0 */
+    [0x1C] = DIRTY(OBJ_P1),                          /* GRP1 */
+    [0x1D] = DIRTY(OBJ_M0),                          /* ENAM0 */
+    [0x1E] = DIRTY(OBJ_M1),                          /* ENAM1 */
+    [0x1F] = DIRTY(OBJ_BL),                          /* ENABL */
+    [0x25] = DIRTY(OBJ_P0),                          /* VDELP0 */
+    [0x26] = DIRTY(OBJ_P1),                          /* VDELP1 */
+    [0x27] = DIRTY(OBJ_BL),                          /* VDELBL */
+    [0x2A] = DIRTY_ALL & ~DIRTY(OBJ_PF),             /* HMOVE */
 };
 
+static void tia_flush(EmulatorState* emu);
+static uint16_t log_collisions(const TIA* tia);
+static void audio_to(TIA* tia, int dot);
+
 void tia_init(EmulatorState* emu)
 {
     memset(&emu->tia, 0, sizeof(TIA));
     emu->tia.inpt4 = 0x80;
     emu->tia.inpt5 = 0x80;
+    emu->tia.mask_dirty = DIRTY_ALL;
 }
 
 void tia_reset(EmulatorState* emu)
 {
+    TiaRenderMode mode = emu->tia.render_mode;
+    int off = emu->tia.render_off;
+    int audio_off = emu->tia.audio_off;
     tia_init(emu);
+    emu->tia.render_mode = mode;
+    emu->tia.render_off = off;
+    emu->tia.audio_off = audio_off;
+}
+
+void tia_set_render_mode(EmulatorState* emu, TiaRenderMode mode)
+{
+    TIA* tia = &emu->tia;
+
+    tia_flush(emu);
+    tia->render_mode = mode;
+    tia->render_dot = tia->dot;
+    tia->mask_dirty = DIRTY_ALL;
+}
+
+/* Frames that are never shown (run-ahead, frame skip) only need the
+ * emulated state: beam position and collisions, not pixels */
+void tia_set_render_off(EmulatorState* emu, int off)
+{
+    tia_flush(emu);
+    emu->tia.render_off = off;
+}
+
+/* Frames that are not heard (run-ahead) keep the sound counters going
+ * but store no samples */
+void tia_set_audio_off(EmulatorState* emu, int off)
+{
+    emu->tia.audio_off = off;
+}
+
+/* Registers were replaced wholesale (state load): rebuild every mask.
+ * The loaded cx already holds all collisions. */
+void tia_invalidate(EmulatorState* emu)
+{
+    emu->tia.mask_dirty = DIRTY_ALL;
+    emu->tia.cx_log_len = 0;
+}
+
+/* Collision latches including the spans not yet folded into cx */
+uint16_t tia_collisions(const EmulatorState* emu)
+{
+    return emu->tia.cx | log_collisions(&emu->tia);
 }
 
 uint8_t tia_read(EmulatorState* emu, uint16_t addr)
@@ -86,15 +108,17 @@ uint8_t tia_read(EmulatorState* emu, uint16_t addr)
     TIA* tia = &emu->tia;
     addr &= 0x0F;
 
+    /* Collisions must include everything drawn so far */
+    if (addr < 0x08) {
+        tia_flush(emu);
+        if (tia->cx_log_len) {
+            tia->cx |= log_collisions(tia);
+            tia->cx_log_len = 0;
+        }
+        return ((tia->cx >> (addr * 2)) & 0x03) << 6;
+    }
+
     switch (addr) {
-        case 0x00: return tia->cxm0p;
-        case 0x01: return tia->cxm1p;
-        case 0x02: return tia->cxp0fb;
-        case 0x03: return tia->cxp1fb;
-        case 0x04: return tia->cxm0fb;
-        case 0x05: return tia->cxm1fb;
-        case 0x06: return tia->cxblpf;
-        case 0x07: return tia->cxppmm;
         case 0x0C: return tia->inpt4;
         case 0x0D: return tia->inpt5;
         default:   return 0;
@@ -106,12 +130,25 @@ void tia_write(EmulatorState* emu, uint16_t addr, uint8_t value)
     TIA* tia = &emu->tia;
     addr &= 0x3F;
 
+    /* Draw the line up to the write with the old register values. With
+     * render_off only object, blanking and collision writes matter. */
+    if (tia->render_off) {
+        if (write_dirty[addr] || addr <= 0x01 || addr == 0x2C) tia_flush(emu);
+    } else if (addr != 0x02 && (addr < 0x15 || addr > 0x1A)) {
+        tia_flush(emu);
+    }
+    /* Sound up to the write with the old register values */
+    if (addr >= 0x15 && addr <= 0x1A) audio_to(tia, tia->dot);
+
     switch (addr) {
         case 0x00: /* VSYNC */
             tia->vsync = value;
             if (value & 0x02) {
+                audio_to(tia, tia->dot);
                 tia->scanline = 0;
                 tia->dot = 0;
+                tia->render_dot = 0;
+                tia->audio_clock = 0;
             }
             break;
         case 0x01: /* VBLANK */
@@ -124,6 +161,7 @@ void tia_write(EmulatorState* emu, uint16_t addr, uint8_t value)
             break;
         case 0x02: /* WSYNC */
             emu->cpu.halted = 1;
+            PROFILE_WSYNC(emu);
             break;
         case 0x04: tia->nusiz0 = value; break;
         case 0x05: tia->nusiz1 = value; break;
@@ -196,12 +234,12 @@ void tia_write(EmulatorState* emu, uint16_t addr, uint8_t value)
             tia->hmbl = 0;
             break;
         case 0x2C: /* CXCLR */
-            tia->cxm0p = tia->cxm1p = 0;
-            tia->cxp0fb = tia->cxp1fb = 0;
-            tia->cxm0fb = tia->cxm1fb = 0;
-            tia->cxblpf = tia->cxppmm = 0;
+            tia->cx = 0;
+            tia->cx_log_len = 0;
             break;
     }
+
+    tia->mask_dirty |= write_dirty[addr];
 }
 
 /* Check if a player pixel is active at position x */
@@ -286,11 +324,562 @@ static int missile_pixel(int x, int pos, uint8_t en, uint8_t nusiz)
     return (rel >= 0 && rel < mw);
 }
 
+/* --- Span renderer --- */
+
+static inline void mask_set(LineMask* m, int x)
+{
+    m->w[x >> 5] |= 1u << (x & 31);
+}
+
+static inline int mask_get(const LineMask* m, int x)
+{
+    return (m->w[x >> 5] >> (x & 31)) & 1;
+}
+
+/* --- Object graphics tables (built at compile time) --- */
+
+#define T4(f, n)   f(n), f((n) + 1), f((n) + 2), f((n) + 3)
+#define T16(f, n)  T4(f, n), T4(f, (n) + 4), T4(f, (n) + 8), T4(f, (n) + 12)
+#define T64(f, n)  T16(f, n), T16(f, (n) + 16), T16(f, (n) + 32), T16(f, (n) + 48)
+#define T256(f)    T64(f, 0), T64(f, 64), T64(f, 128), T64(f, 192)
+
+#define GBIT(g, i) (((uint32_t)(g) >> (i)) & 1u)
+
+/* GRP bit 7 is the leftmost pixel unless REFP is set */
+#define REV8(g) (GBIT(g, 7) | GBIT(g, 6) << 1 | GBIT(g, 5) << 2 | GBIT(g, 4) << 3 | \
+                 GBIT(g, 3) << 4 | GBIT(g, 2) << 5 | GBIT(g, 1) << 6 | GBIT(g, 0) << 7)
+#define X2(g) (GBIT(g, 0) * 0x0003u | GBIT(g, 1) * 0x000Cu | \
+               GBIT(g, 2) * 0x0030u | GBIT(g, 3) * 0x00C0u | \
+               GBIT(g, 4) * 0x0300u | GBIT(g, 5) * 0x0C00u | \
+               GBIT(g, 6) * 0x3000u | GBIT(g, 7) * 0xC000u)
+#define X4(g) (GBIT(g, 0) * 0x0000000Fu | GBIT(g, 1) * 0x000000F0u | \
+               GBIT(g, 2) * 0x00000F00u | GBIT(g, 3) * 0x0000F000u | \
+               GBIT(g, 4) * 0x000F0000u | GBIT(g, 5) * 0x00F00000u | \
+               GBIT(g, 6) * 0x0F000000u | GBIT(g, 7) * 0xF0000000u)
+
+#define PAT1(g)  REV8(g)
+#define PAT1R(g) (g)
+#define PAT2(g)  X2(REV8(g))
+#define PAT2R(g) X2(g)
+#define PAT4(g)  X4(REV8(g))
+#define PAT4R(g) X4(g)
+
+/* [scale][reflect][grp] -> one player copy, bit 0 = leftmost pixel */
+static const uint32_t grp_pattern[3][2][256] = {
+    { { T256(PAT1) }, { T256(PAT1R) } },
+    { { T256(PAT2) }, { T256(PAT2R) } },
+    { { T256(PAT4) }, { T256(PAT4R) } },
+};
+
+/* NUSIZ bits 0-2: copies, their offsets and the pixel scale */
+static const struct {
+    uint8_t copies;
+    uint8_t scale;
+    uint8_t offset[3];
+} nusiz_layout[8] = {
+    { 1, 0, { 0,  0,  0 } },
+    { 2, 0, { 0, 16,  0 } },
+    { 2, 0, { 0, 32,  0 } },
+    { 3, 0, { 0, 16, 32 } },
+    { 2, 0, { 0, 64,  0 } },
+    { 1, 1, { 0,  0,  0 } },
+    { 3, 0, { 0, 32, 64 } },
+    { 1, 2, { 0,  0,  0 } },
+};
+
+/* NUSIZ/CTRLPF bits 4-5: missile and ball width */
+static const uint8_t size_pattern[4] = { 0x01, 0x03, 0x0F, 0xFF };
+
+/* Presence code of a pixel: bit n set when object n (OBJ_*) is drawn */
+#define HAS(c, o)  (((c) >> (o)) & 1u)
+#define CXBIT(c, a, b, reg, d7) ((HAS(c, a) & HAS(c, b)) << ((reg) * 2 + (d7)))
+
+#define CX_ENTRY(c) (CXBIT(c, OBJ_M0, OBJ_P0, 0, 0) | CXBIT(c, OBJ_M0, OBJ_P1, 0, 1) | \
+                     CXBIT(c, OBJ_M1, OBJ_P1, 1, 0) | CXBIT(c, OBJ_M1, OBJ_P0, 1, 1) | \
+                     CXBIT(c, OBJ_P0, OBJ_BL, 2, 0) | CXBIT(c, OBJ_P0, OBJ_PF, 2, 1) | \
+                     CXBIT(c, OBJ_P1, OBJ_BL, 3, 0) | CXBIT(c, OBJ_P1, OBJ_PF, 3, 1) | \
+                     CXBIT(c, OBJ_M0, OBJ_BL, 4, 0) | CXBIT(c, OBJ_M0, OBJ_PF, 4, 1) | \
+                     CXBIT(c, OBJ_M1, OBJ_BL, 5, 0) | CXBIT(c, OBJ_M1, OBJ_PF, 5, 1) | \
+                     CXBIT(c, OBJ_BL, OBJ_PF, 6, 1) | \
+                     CXBIT(c, OBJ_M0, OBJ_M1, 7, 0) | CXBIT(c, OBJ_P0, OBJ_P1, 7, 1))
+
+/* Presence code -> collision latches it sets (TIA.cx layout) */
+static const uint16_t cx_lut[64] = { T64(CX_ENTRY, 0) };
+
+/* Color slots picked by the priority table */
+enum { SLOT_BK, SLOT_P0, SLOT_P1, SLOT_PF };
+
+#define HAS_P0(c) (HAS(c, OBJ_P0) | HAS(c, OBJ_M0))
+#define HAS_P1(c) (HAS(c, OBJ_P1) | HAS(c, OBJ_M1))
+#define HAS_PF(c) (HAS(c, OBJ_PF) | HAS(c, OBJ_BL))
+
+/* pri: CTRLPF bit 2 puts PF/BL above the players; pf: slot of PF/BL,
+ * which takes the player colors in score mode (CTRLPF bit 1) */
+#define PRIO(c, pri, pf) \
+    ((pri) ? (HAS_PF(c) ? (pf) : HAS_P0(c) ? SLOT_P0 : HAS_P1(c) ? SLOT_P1 : SLOT_BK) \
+           : (HAS_P0(c) ? SLOT_P0 : HAS_P1(c) ? SLOT_P1 : HAS_PF(c) ? (pf) : SLOT_BK))
+
+#define PRIO_N(c)  PRIO(c, 0, SLOT_PF)
+#define PRIO_SL(c) PRIO(c, 0, SLOT_P0)
+#define PRIO_SR(c) PRIO(c, 0, SLOT_P1)
+#define PRIO_P(c)  PRIO(c, 1, SLOT_PF)
+#define PRIO_PL(c) PRIO(c, 1, SLOT_P0)
+#define PRIO_PR(c) PRIO(c, 1, SLOT_P1)
+
+/* [CTRLPF bits 1-2][right half][presence code] -> color slot */
+static const uint8_t prio_lut[4][2][64] = {
+    { { T64(PRIO_N, 0) },  { T64(PRIO_N, 0) } },
+    { { T64(PRIO_SL, 0) }, { T64(PRIO_SR, 0) } },
+    { { T64(PRIO_P, 0) },  { T64(PRIO_P, 0) } },
+    { { T64(PRIO_PL, 0) }, { T64(PRIO_PR, 0) } },
+};
+
+/* OR `width` pattern bits into the mask starting at pixel x (0-159),
+ * wrapping around the right edge */
+static void mask_or(LineMask* m, int x, uint32_t bits, int width)
+{
+    if (x + width > 160) {
+        int first = 160 - x;
+        mask_or(m, x, bits & ((1u << first) - 1), first);
+        mask_or(m, 0, bits >> first, width - first);
+        return;
+    }
+
+    int w = x >> 5;
+    int sh = x & 31;
+    m->w[w] |= bits << sh;
+    if (sh && w < 4) m->w[w + 1] |= bits >> (32 - sh);
+}
+
+/* Missile/ball: pixels left of the screen edge are dropped */
+static void build_size_mask(LineMask* m, uint8_t en, int pos, uint8_t size)
+{
+    memset(m, 0, sizeof(*m));
+    if (!(en & 0x02)) return;
+
+    uint32_t bits = size_pattern[(size >> 4) & 0x03];
+    int width = 1 << ((size >> 4) & 0x03);
+    if (pos < 0) {
+        if (pos <= -width) return;
+        bits >>= -pos;
+        width += pos;
+        pos = 0;
+    }
+    mask_or(m, pos, bits, width);
+}
+
+static void build_player_mask(LineMask* m, uint8_t grp, uint8_t ref,
+                              int pos, uint8_t nusiz)
+{
+    memset(m, 0, sizeof(*m));
+    if (!grp) return;
+
+    int mode = nusiz & 0x07;
+    int scale = nusiz_layout[mode].scale;
+    uint32_t bits = grp_pattern[scale][(ref >> 3) & 1][grp];
+
+    for (int c = 0; c < nusiz_layout[mode].copies; c++) {
+        int start = pos + nusiz_layout[mode].offset[c];
+        if (start < 0) start += 160;
+        start %= 160;
+        mask_or(m, start, bits, 8 << scale);
+    }
+}
+
+/* 20 playfield bits in screen order, 4 pixels each, from pixel x */
+static void pf_half(LineMask* m, int x, uint32_t bits)
+{
+    const uint32_t* x4 = grp_pattern[2][1];
+
+    mask_or(m, x, x4[bits & 0xFF], 32);
+    mask_or(m, x + 32, x4[(bits >> 8) & 0xFF], 32);
+    mask_or(m, x + 64, x4[(bits >> 16) & 0x0F], 16);
+}
+
+static void build_pf_mask(LineMask* m, uint8_t pf0, uint8_t pf1, uint8_t pf2,
+                          uint8_t ctrlpf)
+{
+    const uint32_t* rev = grp_pattern[0][0];
+    uint32_t left = (pf0 >> 4) | rev[pf1] << 4 | (uint32_t)pf2 << 12;
+
+    memset(m, 0, sizeof(*m));
+    if (!left) return;
+
+    pf_half(m, 0, left);
+    /* Reflected: the same 20 bits right to left */
+    pf_half(m, 80, (ctrlpf & 0x01) ? rev[pf2] | (uint32_t)pf1 << 8 | (rev[pf0] & 0x0F) << 16
+                                   : left);
+}
+
+static void update_masks(TIA* tia)
+{
+    uint8_t dirty = tia->mask_dirty;
+    LineMask* m = tia->obj_mask;
+
+    if (dirty & DIRTY(OBJ_P0))
+        build_player_mask(&m[OBJ_P0], tia->vdelp0 ? tia->grp0_old : tia->grp0,
+                          tia->refp0, tia->posp0, tia->nusiz0);
+    if (dirty & DIRTY(OBJ_P1))
+        build_player_mask(&m[OBJ_P1], tia->vdelp1 ? tia->grp1_old : tia->grp1,
+                          tia->refp1, tia->posp1, tia->nusiz1);
+    if (dirty & DIRTY(OBJ_M0))
+        build_size_mask(&m[OBJ_M0], tia->enam0, tia->posm0, tia->nusiz0);
+    if (dirty & DIRTY(OBJ_M1))
+        build_size_mask(&m[OBJ_M1], tia->enam1, tia->posm1, tia->nusiz1);
+    if (dirty & DIRTY(OBJ_BL))
+        build_size_mask(&m[OBJ_BL], tia->vdelbl ? tia->enabl_old : tia->enabl,
+                        tia->posbl, tia->ctrlpf);
+    if (dirty & DIRTY(OBJ_PF))
+        build_pf_mask(&m[OBJ_PF], tia->pf0, tia->pf1, tia->pf2, tia->ctrlpf);
+
+    tia->mask_dirty = 0;
+}
+
+/* Collision latches set by pixels [x0, x1), without drawing them */
+static uint16_t span_collisions(const LineMask* m, int x0, int x1)
+{
+    uint64_t seen = 0;
+    uint16_t cx = 0;
+
+    for (int x = x0; x < x1; ) {
+        int w = x >> 5;
+        int end = (w + 1) << 5;
+        if (end > x1) end = x1;
+
+        int sh = x & 31;
+        int n = end - x;
+        uint32_t keep = n == 32 ? 0xFFFFFFFFu : (1u << n) - 1;
+        uint32_t p0 = m[OBJ_P0].w[w] >> sh;
+        uint32_t p1 = m[OBJ_P1].w[w] >> sh;
+        uint32_t m0 = m[OBJ_M0].w[w] >> sh;
+        uint32_t m1 = m[OBJ_M1].w[w] >> sh;
+        uint32_t bl = m[OBJ_BL].w[w] >> sh;
+        uint32_t pf = m[OBJ_PF].w[w] >> sh;
+
+        /* Pixels where two or more objects overlap */
+        uint32_t one = p0, two = 0;
+        two |= one & p1; one |= p1;
+        two |= one & m0; one |= m0;
+        two |= one & m1; one |= m1;
+        two |= one & bl; one |= bl;
+        two |= one & pf;
+        two &= keep;
+
+        for (int b = 0; two; b++, two >>= 1)
+            if (two & 1)
+                seen |= (uint64_t)1 << ((p0 >> b & 1) | (p1 >> b & 1) << 1 |
+                                        (m0 >> b & 1) << 2 | (m1 >> b & 1) << 3 |
+                                        (bl >> b & 1) << 4 | (pf >> b & 1) << 5);
+        x = end;
+    }
+
+    for (int code = 0; seen; code++, seen >>= 1)
+        if (seen & 1) cx |= cx_lut[code];
+    return cx;
+}
+
+/* --- Deferred collisions ---
+ *
+ * Most games read the collision latches once a frame, if at all, so the
+ * span renderer does not compute them while drawing: each span only
+ * records the object registers it was drawn with, and the masks and
+ * collisions are worked out when the game reads a CX register. A CXCLR
+ * before that discards the spans unseen. Spans with fewer than two
+ * objects cannot collide and are not recorded; consecutive spans with
+ * the same registers are merged, so a still frame needs few entries. */
+
+/* Collisions of the recorded spans, rebuilding only the masks whose
+ * registers differ from the previous span */
+static uint16_t log_collisions(const TIA* tia)
+{
+    LineMask m[OBJ_COUNT];
+    const CxRegs* prev = NULL;
+    uint16_t cx = 0;
+
+#define CHANGED(f) (!prev || prev->f != r->f)
+    for (int i = 0; i < tia->cx_log_len; i++) {
+        const CxSpan* s = &tia->cx_log[i];
+        const CxRegs* r = &s->regs;
+
+        if (CHANGED(grp[0]) || CHANGED(refp[0]) || CHANGED(copies[0]) || CHANGED(pos[0]))
+            build_player_mask(&m[OBJ_P0], r->grp[0], r->refp[0], r->pos[0], r->copies[0]);
+        if (CHANGED(grp[1]) || CHANGED(refp[1]) || CHANGED(copies[1]) || CHANGED(pos[1]))
+            build_player_mask(&m[OBJ_P1], r->grp[1], r->refp[1], r->pos[1], r->copies[1]);
+        if (CHANGED(enam[0]) || CHANGED(msize[0]) || CHANGED(pos[2]))
+            build_size_mask(&m[OBJ_M0], r->enam[0], r->pos[2], r->msize[0]);
+        if (CHANGED(enam[1]) || CHANGED(msize[1]) || CHANGED(pos[3]))
+            build_size_mask(&m[OBJ_M1], r->enam[1], r->pos[3], r->msize[1]);
+        if (CHANGED(enabl) || CHANGED(blsize) || CHANGED(pos[4]))
+            build_size_mask(&m[OBJ_BL], r->enabl, r->pos[4], r->blsize);
+        if (CHANGED(pf[0]) || CHANGED(pf[1]) || CHANGED(pf[2]) || CHANGED(pf_reflect))
+            build_pf_mask(&m[OBJ_PF], r->pf[0], r->pf[1], r->pf[2], r->pf_reflect);
+
+        cx |= span_collisions(m, s->x0, s->x1);
+        prev = r;
+    }
+#undef CHANGED
+    return cx;
+}
+
+static void log_span(TIA* tia, int x0, int x1)
+{
+    CxSpan s;
+    CxRegs* r = &s.regs;
+    int objects = 0;
+
+    memset(&s, 0, sizeof(s));
+
+    uint8_t g0 = tia->vdelp0 ? tia->grp0_old : tia->grp0;
+    uint8_t g1 = tia->vdelp1 ? tia->grp1_old : tia->grp1;
+    uint8_t bl = tia->vdelbl ? tia->enabl_old : tia->enabl;
+
+    if (g0) {
+        r->grp[0] = g0; r->refp[0] = tia->refp0 & 0x08;
+        r->copies[0] = tia->nusiz0 & 0x07; r->pos[0] = tia->posp0;
+        objects++;
+    }
+    if (g1) {
+        r->grp[1] = g1; r->refp[1] = tia->refp1 & 0x08;
+        r->copies[1] = tia->nusiz1 & 0x07; r->pos[1] = tia->posp1;
+        objects++;
+    }
+    if (tia->enam0 & 0x02) {
+        r->enam[0] = 0x02; r->msize[0] = tia->nusiz0 & 0x30; r->pos[2] = tia->posm0;
+        objects++;
+    }
+    if (tia->enam1 & 0x02) {
+        r->enam[1] = 0x02; r->msize[1] = tia->nusiz1 & 0x30; r->pos[3] = tia->posm1;
+        objects++;
+    }
+    if (bl & 0x02) {
+        r->enabl = 0x02; r->blsize = tia->ctrlpf & 0x30; r->pos[4] = tia->posbl;
+        objects++;
+    }
+    if ((tia->pf0 & 0xF0) | tia->pf1 | tia->pf2) {
+        r->pf[0] = tia->pf0 & 0xF0; r->pf[1] = tia->pf1; r->pf[2] = tia->pf2;
+        r->pf_reflect = tia->ctrlpf & 0x01;
+        objects++;
+    }
+    if (objects < 2) return;
+
+    if (tia->cx_log_len) {
+        CxSpan* last = &tia->cx_log[tia->cx_log_len - 1];
+        if (x0 <= last->x1 && x1 >= last->x0 &&
+            !memcmp(&last->regs, r, sizeof(CxRegs))) {
+            if (x0 < last->x0) last->x0 = (uint8_t)x0;
+            if (x1 > last->x1) last->x1 = (uint8_t)x1;
+            return;
+        }
+    }
+
+    if (tia->cx_log_len == CX_LOG_SIZE) {
+        tia->cx |= log_collisions(tia);
+        tia->cx_log_len = 0;
+    }
+    s.x0 = (uint8_t)x0;
+    s.x1 = (uint8_t)x1;
+    tia->cx_log[tia->cx_log_len++] = s;
+}
+
+/* Composite pixels [x0, x1) of visible line y from the object masks */
+static void render_span(EmulatorState* emu, int y, int x0, int x1)
+{
+    TIA* tia = &emu->tia;
+    Pixel* out = &emu->framebuffer[y * 160];
+
+    if (tia->vblank & 0x02) {
+        for (int x = x0; x < x1; x++) out[x] = PIXEL(emu, 0x00);
+        return;
+    }
+
+    if (tia->mask_dirty) update_masks(tia);
+    const LineMask* m = tia->obj_mask;
+
+    Pixel colors[4];
+    colors[SLOT_BK] = PIXEL(emu, tia->colubk);
+    colors[SLOT_P0] = PIXEL(emu, tia->colup0);
+    colors[SLOT_P1] = PIXEL(emu, tia->colup1);
+    colors[SLOT_PF] = PIXEL(emu, tia->colupf);
+
+    const uint8_t (*prio)[64] = prio_lut[(tia->ctrlpf >> 1) & 0x03];
+
+    int x = x0;
+    while (x < x1) {
+        int w = x >> 5;
+        int end = (w + 1) << 5;
+        if (end > x1) end = x1;
+
+        int sh = x & 31;
+        uint32_t p0 = m[OBJ_P0].w[w] >> sh;
+        uint32_t p1 = m[OBJ_P1].w[w] >> sh;
+        uint32_t m0 = m[OBJ_M0].w[w] >> sh;
+        uint32_t m1 = m[OBJ_M1].w[w] >> sh;
+        uint32_t bl = m[OBJ_BL].w[w] >> sh;
+        uint32_t pf = m[OBJ_PF].w[w] >> sh;
+
+        /* Nothing but background in this 32-pixel word */
+        if (!(p0 | p1 | m0 | m1 | bl | pf)) {
+            for (; x < end; x++) out[x] = colors[SLOT_BK];
+            continue;
+        }
+
+        for (; x < end; x++) {
+            int code = (p0 & 1) | (p1 & 1) << 1 | (m0 & 1) << 2 |
+                       (m1 & 1) << 3 | (bl & 1) << 4 | (pf & 1) << 5;
+            out[x] = colors[prio[x >= 80][code]];
+            p0 >>= 1; p1 >>= 1; m0 >>= 1;
+            m1 >>= 1; bl >>= 1; pf >>= 1;
+        }
+    }
+}
+
+/* Draw the current line from render_dot up to `dot` */
+static void render_to(EmulatorState* emu, int dot)
+{
+    TIA* tia = &emu->tia;
+    int y = tia->scanline - 40; /* visible starts at scanline ~40 */
+
+    if (dot <= tia->render_dot) return;
+
+    if (y >= 0 && y < 192) {
+        int x0 = tia->render_dot - 68; /* visible area starts at dot 68 */
+        int x1 = dot - 68;
+        if (x0 < 0) x0 = 0;
+        if (x1 > 160) x1 = 160;
+        if (x0 < x1) {
+            if (!tia->render_off) render_span(emu, y, x0, x1);
+            if (!(tia->vblank & 0x02)) log_span(tia, x0, x1);
+        }
+    }
+    tia->render_dot = dot;
+}
+
+static void tia_flush(EmulatorState* emu)
+{
+    if (emu->tia.render_mode == TIA_RENDER_SPAN)
+        render_to(emu, emu->tia.dot);
+}
+
+/* Audio. Each line has two audio clocks (31.4 kHz), each in two phases:
+ * phase 0 at dots 9 and 81 steps the frequency dividers and latches the
+ * counter feedback, phase 1 at 37 and 149 shifts the noise and pulse
+ * counters and gives the sample. Nothing ticks per dot: audio register
+ * writes and the end of the line run the clocks the beam has passed, so
+ * a line costs four small steps and each sample still sees the register
+ * values of its moment. */
+static const uint8_t audio_clock_dot[4] = { 9, 37, 81, 149 };
+
+/* Full scale of the sum of both channels (2 x volume 15) */
+#define AUDIO_SCALE (32767 / 30)
+
+static void audio_phase0(AudioChannel* ch, uint8_t audc, uint8_t audf)
+{
+    audc &= 0x0F;
+    audf &= 0x1F;
+
+    if (ch->clock_en) {
+        ch->noise_bit4 = ch->noise & 0x01;
+
+        switch (audc & 0x03) {
+            case 0x02: ch->pulse_hold = (ch->noise & 0x1E) != 0x02; break;
+            case 0x03: ch->pulse_hold = !ch->noise_bit4; break;
+            default:   ch->pulse_hold = 0; break;
+        }
+
+        if ((audc & 0x03) == 0)
+            ch->noise_fb = ((ch->pulse ^ ch->noise) & 0x01) ||
+                           !(ch->noise || ch->pulse != 0x0A) || !(audc & 0x0C);
+        else
+            ch->noise_fb = (((ch->noise >> 2) ^ ch->noise) & 0x01) || ch->noise == 0;
+    }
+
+    ch->clock_en = ch->div == audf;
+    if (ch->div == audf || ch->div == 0x1F) ch->div = 0;
+    else                                    ch->div++;
+}
+
+static int audio_phase1(AudioChannel* ch, uint8_t audc, uint8_t audv)
+{
+    audc &= 0x0F;
+
+    if (ch->clock_en) {
+        int fb = 0;
+
+        switch (audc >> 2) {
+            case 0: fb = (((ch->pulse >> 1) ^ ch->pulse) & 0x01) &&
+                         ch->pulse != 0x0A && (audc & 0x03); break;
+            case 1: fb = !(ch->pulse & 0x08); break;
+            case 2: fb = !ch->noise_bit4; break;
+            case 3: fb = !((ch->pulse & 0x02) || !(ch->pulse & 0x0E)); break;
+        }
+
+        ch->noise >>= 1;
+        if (ch->noise_fb) ch->noise |= 0x10;
+        if (!ch->pulse_hold) {
+            ch->pulse = ~(ch->pulse >> 1) & 0x07;
+            if (fb) ch->pulse |= 0x08;
+        }
+    }
+    return (ch->pulse & 0x01) * (audv & 0x0F);
+}
+
+/* Run the audio clocks of the current line before `dot` */
+static void audio_to(TIA* tia, int dot)
+{
+    while (tia->audio_clock < 4 && audio_clock_dot[tia->audio_clock] < dot) {
+        if (tia->audio_clock & 1) {
+            int v = audio_phase1(&tia->aud[0], tia->audc0, tia->audv0) +
+                    audio_phase1(&tia->aud[1], tia->audc1, tia->audv1);
+            if (!tia->audio_off && tia->audio_len < TIA_AUDIO_MAX)
+                tia->audio[tia->audio_len++] = (int16_t)(v * AUDIO_SCALE);
+        } else {
+            audio_phase0(&tia->aud[0], tia->audc0, tia->audf0);
+            audio_phase0(&tia->aud[1], tia->audc1, tia->audf1);
+        }
+        tia->audio_clock++;
+    }
+}
+
+/* Span mode: only the beam position advances; pixels are drawn when a
+ * register write or the end of the line flushes the pending span */
+static void tick_span(EmulatorState* emu, int tia_cycles)
+{
+    TIA* tia = &emu->tia;
+
+    while (tia_cycles > 0) {
+        int left = 228 - tia->dot;
+        if (tia_cycles < left) {
+            tia->dot += tia_cycles;
+            return;
+        }
+        tia_cycles -= left;
+
+        render_to(emu, 228);
+        audio_to(tia, 228);
+        tia->dot = 0;
+        tia->render_dot = 0;
+        tia->audio_clock = 0;
+        tia->scanline++;
+        emu->cpu.halted = 0; /* Release WSYNC */
+
+        if (tia->scanline >= 262) {
+            tia->scanline = 0;
+            emu->frame_ready = 1;
+            tia->frame_done = 1;
+        }
+    }
+}
+
 void tia_tick(EmulatorState* emu, int cpu_cycles)
 {
     TIA* tia = &emu->tia;
     int tia_cycles = cpu_cycles * 3; /* 3 TIA clocks per CPU cycle */
 
+    if (tia->render_mode == TIA_RENDER_SPAN) {
+        tick_span(emu, tia_cycles);
+        return;
+    }
+
     for (int i = 0; i < tia_cycles; i++) {
         int x = tia->dot - 68; /* visible area starts at dot 68 */
         int y = tia->scanline - 40; /* visible starts at scanline ~40 */
@@ -298,71 +887,37 @@ void tia_tick(EmulatorState* emu, int cpu_cycles)
         /* Render pixel */
         if (x >= 0 && x < 160 && y >= 0 && y < 192) {
             if (tia->vblank & 0x02) {
-                emu->framebuffer[y * 160 + x] = 0x000000;
+                if (!tia->render_off)
+                    emu->framebuffer[y * 160 + x] = PIXEL(emu, 0x00);
             } else {
-                uint32_t color = ntsc_palette[tia->colubk & 0xFE];
-
-                int pf = pf_pixel(tia, x);
-                int bl = ball_pixel(tia, x);
-
                 uint8_t g0 = (tia->vdelp0) ? tia->grp0_old : tia->grp0;
                 uint8_t g1 = (tia->vdelp1) ? tia->grp1_old : tia->grp1;
-                int p0 = player_pixel(g0, tia->refp0, tia->posp0, tia->nusiz0, x);
-                int p1 = player_pixel(g1, tia->refp1, tia->posp1, tia->nusiz1, x);
-
-                int m0 = missile_pixel(x, tia->posm0, tia->enam0, tia->nusiz0);
-                int m1 = missile_pixel(x, tia->posm1, tia->enam1, tia->nusiz1);
-
-                /* Priority: ctrlpf bit 2 */
-                if (tia->ctrlpf & 0x04) {
-                    /* PF/BL on top */
-                    if (pf || bl) {
-                        color = ntsc_palette[(tia->ctrlpf & 0x02) ?
-                            ((x < 80) ? tia->colup0 : tia->colup1) & 0xFE :
-                            tia->colupf & 0xFE];
-                    } else if (p0 || m0) {
-                        color = ntsc_palette[tia->colup0 & 0xFE];
-                    } else if (p1 || m1) {
-                        color = ntsc_palette[tia->colup1 & 0xFE];
-                    }
-                } else {
-                    /* Players on top */
-                    if (p0 || m0) {
-                        color = ntsc_palette[tia->colup0 & 0xFE];
-                    } else if (p1 || m1) {
-                        color = ntsc_palette[tia->colup1 & 0xFE];
-                    } else if (pf || bl) {
-                        color = ntsc_palette[(tia->ctrlpf & 0x02) ?
-                            ((x < 80) ? tia->colup0 : tia->colup1) & 0xFE :
-                            tia->colupf & 0xFE];
-                    }
-                }
-
-                /* Collisions */
-                if (m0 && p0) tia->cxm0p |= 0x40;
-                if (m0 && p1) tia->cxm0p |= 0x80;
-                if (m1 && p1) tia->cxm1p |= 0x40;
-                if (m1 && p0) tia->cxm1p |= 0x80;
-                if (p0 && pf) tia->cxp0fb |= 0x80;
-                if (p0 && bl) tia->cxp0fb |= 0x40;
-                if (p1 && pf) tia->cxp1fb |= 0x80;
-                if (p1 && bl) tia->cxp1fb |= 0x40;
-                if (m0 && pf) tia->cxm0fb |= 0x80;
-                if (m0 && bl) tia->cxm0fb |= 0x40;
-                if (m1 && pf) tia->cxm1fb |= 0x80;
-                if (m1 && bl) tia->cxm1fb |= 0x40;
-                if (bl && pf) tia->cxblpf |= 0x80;
-                if (p0 && p1) tia->cxppmm |= 0x80;
-                if (m0 && m1) tia->cxppmm |= 0x40;
-
-                emu->framebuffer[y * 160 + x] = color;
+                int code = player_pixel(g0, tia->refp0, tia->posp0, tia->nusiz0, x) << OBJ_P0 |
+                           player_pixel(g1, tia->refp1, tia->posp1, tia->nusiz1, x) << OBJ_P1 |
+                           missile_pixel(x, tia->posm0, tia->enam0, tia->nusiz0) << OBJ_M0 |
+                           missile_pixel(x, tia->posm1, tia->enam1, tia->nusiz1) << OBJ_M1 |
+                           ball_pixel(tia, x) << OBJ_BL |
+                           pf_pixel(tia, x) << OBJ_PF;
+                uint8_t regs[4];
+                regs[SLOT_BK] = tia->colubk;
+                regs[SLOT_P0] = tia->colup0;
+                regs[SLOT_P1] = tia->colup1;
+                regs[SLOT_PF] = tia->colupf;
+
+                uint8_t slot = prio_lut[(tia->ctrlpf >> 1) & 0x03][x >= 80][code];
+                tia->cx |= cx_lut[code];
+
+                if (!tia->render_off)
+                    emu->framebuffer[y * 160 + x] = PIXEL(emu, regs[slot]);
             }
         }
 
         /* Advance dot/scanline */
         tia->dot++;
         if (tia->dot >= 228) {
+            audio_to(tia, 228);
             tia->dot = 0;
+            tia->audio_clock = 0;
             tia->scanline++;
             emu->cpu.halted = 0; /* Release WSYNC */
 
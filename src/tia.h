@@ -8,5 +8,10 @@ void    tia_reset(EmulatorState* emu);
 uint8_t tia_read(EmulatorState* emu, uint16_t addr);
 void    tia_write(EmulatorState* emu, uint16_t addr, uint8_t value);
 void    tia_tick(EmulatorState* emu, int cpu_cycles);
+void    tia_set_render_mode(EmulatorState* emu, TiaRenderMode mode);
+void    tia_set_render_off(EmulatorState* emu, int off);
+void    tia_set_audio_off(EmulatorState* emu, int off);
+void    tia_invalidate(EmulatorState* emu);
+uint16_t tia_collisions(const EmulatorState* emu);
 
 #endif
@@ -6,6 +6,61 @@
 /* ============================================
  * TIA - Television Interface Adaptor
  * ============================================ */
+typedef enum {
+    TIA_RENDER_SPAN = 0, /* batched: draw spans between register writes */
+    TIA_RENDER_PIXEL     /* reference: composite every color clock */
+} TiaRenderMode;
+
+/* One bit per visible pixel of a scanline */
+typedef struct {
+    uint32_t w[5];
+} LineMask;
+
+/* Object registers behind a span whose collisions are not computed yet.
+ * Objects that are not drawn are all zero, so equal states compare
+ * equal. */
+typedef struct {
+    int16_t pos[5];         /* P0 P1 M0 M1 BL */
+    uint8_t grp[2];         /* after VDELP */
+    uint8_t refp[2];
+    uint8_t copies[2];      /* NUSIZ bits 0-2 */
+    uint8_t msize[2];       /* NUSIZ bits 4-5 */
+    uint8_t enam[2];
+    uint8_t enabl;          /* after VDELBL */
+    uint8_t blsize;         /* CTRLPF bits 4-5 */
+    uint8_t pf[3];
+    uint8_t pf_reflect;
+} CxRegs;
+
+typedef struct {
+    CxRegs  regs;
+    uint8_t x0, x1;
+} CxSpan;
+
+#define CX_LOG_SIZE 64
+
+/* One sound channel: frequency divider, 5-bit noise and 4-bit pulse
+ * counters, and the latches between the two audio clock phases */
+typedef struct {
+    uint8_t div;
+    uint8_t noise;
+    uint8_t pulse;
+    uint8_t clock_en;
+    uint8_t noise_fb;
+    uint8_t pulse_hold;
+    uint8_t noise_bit4;
+} AudioChannel;
+
+/* A frame ends when the beam passes line 262. ROMs that keep restarting
+ * it with VSYNC never get there, so a frame is also cut off after twice
+ * the cycles of a normal one. */
+#define FRAME_CYCLE_LIMIT (2 * 262 * 76)
+
+#define TIA_SAMPLE_RATE 31400   /* two samples per scanline: 3.58 MHz / 114 */
+/* Samples kept per frame: two per line of the longest (cut off) frame,
+ * and the line the last instruction or WSYNC runs into past the limit */
+#define TIA_AUDIO_MAX   (2 * (FRAME_CYCLE_LIMIT / 76 + 1))
+
 typedef struct {
     /* Sync */
     uint8_t vsync;
@@ -38,9 +93,13 @@ typedef struct {
     int16_t posm0, posm1;
     int16_t posbl;
 
-    /* Collision registers */
-    uint8_t cxm0p, cxm1p, cxp0fb, cxp1fb;
-    uint8_t cxm0fb, cxm1fb, cxblpf, cxppmm;
+    /* Collision registers: bits 2n/2n+1 are D6/D7 of CXM0P+n */
+    uint16_t cx;
+
+    /* Span mode: spans whose collisions are still to be added to cx,
+     * on the next CX read */
+    CxSpan   cx_log[CX_LOG_SIZE];
+    int      cx_log_len;
 
     /* VDELP / VDELBL */
     uint8_t vdelp0, vdelp1, vdelbl;
@@ -53,10 +112,24 @@ typedef struct {
     int dot;
     int frame_done;
 
-    /* Audio (stub) */
+    /* Span renderer: line drawn up to render_dot, object masks rebuilt
+     * when their registers change */
+    TiaRenderMode render_mode;
+    int      render_off;    /* frame not shown: skip pixel output */
+    int      render_dot;
+    uint8_t  mask_dirty;
+    LineMask obj_mask[6];
+
+    /* Audio: registers, channel counters, next audio clock of the line
+     * and the samples of the current frame */
     uint8_t audc0, audc1;
     uint8_t audf0, audf1;
     uint8_t audv0, audv1;
+    AudioChannel aud[2];
+    int      audio_clock;
+    int      audio_off;     /* frame not heard: counters only, no samples */
+    int      audio_len;
+    int16_t  audio[TIA_AUDIO_MAX];
 
     /* Input latches */
     uint8_t inpt4, inpt5;
@@ -71,9 +144,11 @@ typedef struct {
     uint8_t porta;
     uint8_t portb;
 
-    uint32_t timer_value;
-    uint32_t timer_interval;
-    uint8_t  timer_underflow;
+    /* Interval timer, evaluated from cpu.cycles when read */
+    uint64_t timer_start;  /* cpu.cycles of the TIMxT write */
+    uint64_t timer_read;   /* last INTIM read or timer write */
+    uint8_t  timer_value;  /* value written */
+    uint8_t  timer_shift;  /* interval is 1 << shift cycles */
 } RIOT;
 
 /* ============================================
@@ -94,13 +169,65 @@ typedef enum {
     CART_UA     /* UA Ltd */
 } CartType;
 
+typedef enum {
+    TV_NTSC = 0,
+    TV_PAL
+} TvFormat;
+
+/* Largest image any scheme addresses (3F: 256 banks of 2K) */
+#define CART_MAX_ROM_SIZE (512 * 1024)
+
+/* A whole ROM file, mapped or read into memory (romfile.c) */
+typedef struct {
+    const uint8_t* data;
+    uint32_t size;
+    int      mapped;
+} RomFile;
+
+/* ROM contents, never written after loading and shared by every
+ * cartridge that runs them (romcache.c) */
+typedef struct RomImage {
+    const uint8_t* data;
+    uint32_t size;
+    uint64_t hash;
+    uint8_t  md5[16];   /* romdb key */
+    int      refs;
+    RomFile  file;
+    struct RomImage* next;
+} RomImage;
+
+/* The 4K cartridge window is mapped in 128-byte segments, fine enough
+ * for every RAM port (Superchip has the smallest); ROM banks of 1K/2K/4K
+ * take several segments */
+#define CART_SEG_SHIFT 7
+#define CART_SEG_SIZE  (1 << CART_SEG_SHIFT)
+#define CART_SEG_MASK  (CART_SEG_SIZE - 1)
+#define CART_SEGS      (0x1000 >> CART_SEG_SHIFT)
+#define CART_SLOTS     4   /* independently switched parts of the window */
+
 typedef struct {
-    uint8_t* rom;
+    /* ROM data: read-only, possibly shared with other instances */
+    const uint8_t* rom;
     uint32_t rom_size;
+    uint64_t rom_hash;  /* identifies the ROM in save states */
+    RomImage* image;    /* reference held until unload, NULL if rom is the caller's */
     CartType type;
-    int current_bank;
+    int superchip;      /* F8/F6/F4 with 128 bytes of RAM */
+    TvFormat tv;
+    int known;          /* found in the ROM database, not guessed */
     int num_banks;
-    uint8_t extra_ram[256]; /* For bankswitching with RAM */
+    int bus_hooks;      /* banks also switch outside the window (3F, UA) */
+    uint16_t hot_lo;    /* bankswitch hotspots: offsets hot_lo .. hot_lo+hot_len-1 */
+    uint16_t hot_len;
+
+    /* Per-instance state */
+    uint8_t bank[CART_SLOTS];   /* bank selected in each slot */
+    uint8_t extra_ram[2048]; /* For bankswitching with RAM */
+
+    /* Segment pointers for the selected banks, rebuilt by cart_map();
+     * NULL reads as open bus, NULL writes are dropped */
+    const uint8_t* rd_seg[CART_SEGS];
+    uint8_t*       wr_seg[CART_SEGS];
 } Cartridge;
 
 /* ============================================
@@ -114,6 +241,7 @@ typedef struct {
     uint16_t PC;
     uint8_t  P;
     uint64_t cycles;
+    uint64_t instructions;
     int      halted; /* WSYNC halt */
 } CPU6507;
 
@@ -127,12 +255,36 @@ typedef struct {
 #define FLAG_V  0x40
 #define FLAG_N  0x80
 
+/* ============================================
+ * Memory map: 64-byte pages over the 8K bus
+ * ============================================ */
+#define MEM_PAGE_SHIFT 6
+#define MEM_PAGE_SIZE  (1 << MEM_PAGE_SHIFT)
+#define MEM_PAGE_MASK  (MEM_PAGE_SIZE - 1)
+#define MEM_PAGES      (0x2000 >> MEM_PAGE_SHIFT)
+
 /* ============================================
  * Emulator State
  * ============================================ */
 #define SCREEN_W 160
 #define SCREEN_H 192
 
+/* FB_INDEXED: the framebuffer keeps raw TIA color indices and is turned
+ * into RGB once per frame; otherwise pixels are 0xRRGGBB */
+#ifdef FB_INDEXED
+typedef uint8_t  Pixel;
+#else
+typedef uint32_t Pixel;
+#endif
+
+/* Scheduler: BATCH runs the CPU up to the next TIA/timer event and lets
+ * the TIA catch up on access; LOCKSTEP ticks them after every
+ * instruction (reference for A/B tests) */
+typedef enum {
+    EMU_SCHED_BATCH = 0,
+    EMU_SCHED_LOCKSTEP
+} EmuSchedMode;
+
 typedef struct {
     CPU6507   cpu;
     TIA       tia;
@@ -140,7 +292,14 @@ typedef struct {
     Cartridge cart;
 
     uint8_t  ram[128];
-    uint32_t framebuffer[SCREEN_W * SCREEN_H];
+    Pixel    framebuffer[SCREEN_W * SCREEN_H];
+    const uint32_t* palette; /* 256 entries, indexed by color & 0xFE */
+
+    /* Page map: direct pointers to RAM/ROM, NULL = TIA/RIOT/hotspot
+     * handler. Points into this struct, so call mem_map_init() after
+     * copying an EmulatorState. */
+    const uint8_t* read_map[MEM_PAGES];
+    uint8_t*       write_map[MEM_PAGES];
 
     /* Input: joystick directions + fire */
     uint8_t joy0_up, joy0_down, joy0_left, joy0_right, joy0_fire;
@@ -155,6 +314,14 @@ typedef struct {
 
     int frame_ready;
     int running;
+
+    EmuSchedMode sched_mode;
+    uint64_t     sync_cycles; /* cpu.cycles the TIA has caught up to */
+    int          run_ahead;   /* frames emulated ahead of the shown one */
+
+#ifdef CPU_PROFILE
+    struct Profile* profile;  /* see profile.h, NULL when not profiling */
+#endif
 } EmulatorState;
 
 #endif /* TYPES_H */
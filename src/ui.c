@@ -15,11 +15,30 @@
 static char padBuf[256] __attribute__((aligned(64)));
 static int frame_count = 0;
 static int pad_initialized = 0;
+static uint16_t pad_btns = 0xFFFF;
 
 static GSGLOBAL* gsGlobal = NULL;
 static GSTEXTURE texture;
 static int gfx_initialized = 0;
 
+#ifdef FB_INDEXED
+#define TEX_PSM GS_PSM_T8
+static const uint32_t* clut_palette = NULL;
+
+/* CSM1 stores T8 CLUT entries 8-15 and 16-23 of every 32 swapped */
+static void load_clut(const uint32_t* pal)
+{
+    uint32_t* clut = (uint32_t*)texture.Clut;
+    int i;
+
+    for (i = 0; i < 256; i++)
+        clut[(i & 0xE7) | ((i & 0x08) << 1) | ((i & 0x10) >> 1)] = pal[i];
+    clut_palette = pal;
+}
+#else
+#define TEX_PSM GS_PSM_CT32
+#endif
+
 #define MAX_PATH_LEN 256
 
 static void simple_delay(int loops)
@@ -120,19 +139,34 @@ static int init_graphics(void)
     
     texture.Width = 160;
     texture.Height = 192;
-    texture.PSM = GS_PSM_CT32;
-    texture.Mem = memalign(128, 160 * 192 * 4);
+    texture.PSM = TEX_PSM;
+    texture.Mem = memalign(128, sizeof(((EmulatorState*)0)->framebuffer));
     
     if (!texture.Mem) {
         scr_printf("ERROR: Cannot allocate texture memory\n");
         return 0;
     }
     
-    memset(texture.Mem, 0, 160 * 192 * 4);
+    memset(texture.Mem, 0, sizeof(((EmulatorState*)0)->framebuffer));
     
     texture.Vram = gsKit_vram_alloc(gsGlobal, 
-        gsKit_texture_size(160, 192, GS_PSM_CT32), 
+        gsKit_texture_size(160, 192, TEX_PSM), 
+        GSKIT_ALLOC_USERBUFFER);
+
+#ifdef FB_INDEXED
+    /* 256-entry CLUT, 16x16 CT32 */
+    texture.ClutPSM = GS_PSM_CT32;
+    texture.ClutStorageMode = GS_CLUT_STORAGE_CSM1;
+    texture.Clut = memalign(128, 256 * 4);
+    if (!texture.Clut) {
+        scr_printf("ERROR: Cannot allocate CLUT memory\n");
+        return 0;
+    }
+    texture.VramClut = gsKit_vram_alloc(gsGlobal,
+        gsKit_texture_size(16, 16, GS_PSM_CT32),
         GSKIT_ALLOC_USERBUFFER);
+    clut_palette = NULL;
+#endif
     
     texture.Filter = GS_FILTER_NEAREST;
     
@@ -153,6 +187,10 @@ void ui_shutdown(void)
         free(texture.Mem);
         texture.Mem = NULL;
     }
+    if (gfx_initialized && texture.Clut) {
+        free(texture.Clut);
+        texture.Clut = NULL;
+    }
 }
 
 void ui_render_frame(EmulatorState* emu)
@@ -166,8 +204,14 @@ void ui_render_frame(EmulatorState* emu)
     }
     
     if (texture.Mem && emu->framebuffer) {
-        memcpy(texture.Mem, emu->framebuffer, 160 * 192 * 4);
+        memcpy(texture.Mem, emu->framebuffer, sizeof(emu->framebuffer));
     }
+#ifdef FB_INDEXED
+    /* Palette switches only rewrite the CLUT */
+    if (emu->palette != clut_palette) {
+        load_clut(emu->palette);
+    }
+#endif
     
     gsKit_TexManager_invalidate(gsGlobal, &texture);
     
@@ -211,6 +255,7 @@ void ui_handle_input(EmulatorState* emu)
 {
     uint16_t btns = read_pad();
     
+    pad_btns = btns;
     if (btns == 0xFFFF) return;
 
     emu->joy0_up    = (btns & PAD_UP) == 0;
@@ -227,6 +272,18 @@ void ui_handle_input(EmulatorState* emu)
     }
 }
 
+/* L1 held: play backwards */
+int ui_rewind_held(void)
+{
+    return (pad_btns & PAD_L1) == 0;
+}
+
+/* R1 held: fast-forward */
+int ui_fast_forward_held(void)
+{
+    return (pad_btns & PAD_R1) == 0;
+}
+
 char* ui_file_browser(const char* start_path)
 {
     static char selected_file[MAX_PATH_LEN];
@@ -297,5 +354,7 @@ int ui_init(void) { return 1; }
 void ui_shutdown(void) {}
 void ui_render_frame(EmulatorState* emu) { (void)emu; }
 void ui_handle_input(EmulatorState* emu) { (void)emu; }
+int ui_rewind_held(void) { return 0; }
+int ui_fast_forward_held(void) { return 0; }
 char* ui_file_browser(const char* path) { (void)path; return NULL; }
 #endif
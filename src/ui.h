@@ -7,6 +7,8 @@ int   ui_init(void);
 void  ui_shutdown(void);
 void  ui_render_frame(EmulatorState* emu);
 void  ui_handle_input(EmulatorState* emu);
+int   ui_rewind_held(void);
+int   ui_fast_forward_held(void);
 char* ui_file_browser(const char* start_path);
 
 #endif
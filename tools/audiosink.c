@@ -0,0 +1,135 @@
+#include "audiosink.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <time.h>
+
+struct AudioSink {
+    AudioOut*    ao;
+    FILE*        wav;
+    int          period;
+    int16_t*     buf;           /* one period */
+    int          realtime;
+    volatile int stop;
+    uint64_t     written;
+    pthread_t    tid;
+};
+
+static void put_le(FILE* f, uint32_t v, int bytes)
+{
+    while (bytes--) {
+        fputc(v & 0xFF, f);
+        v >>= 8;
+    }
+}
+
+void wav_write_header(FILE* f, int rate, uint32_t samples)
+{
+    fwrite("RIFF", 1, 4, f);
+    put_le(f, 36 + samples * 2, 4);
+    fwrite("WAVEfmt ", 1, 8, f);
+    put_le(f, 16, 4);
+    put_le(f, 1, 2);                        /* PCM */
+    put_le(f, 1, 2);                        /* mono */
+    put_le(f, rate, 4);
+    put_le(f, rate * 2, 4);
+    put_le(f, 2, 2);
+    put_le(f, 16, 2);
+    fwrite("data", 1, 4, f);
+    put_le(f, samples * 2, 4);
+}
+
+static void emit(AudioSink* sink, const int16_t* buf, int n)
+{
+    for (int i = 0; sink->wav && i < n; i++)
+        put_le(sink->wav, (uint16_t)buf[i], 2);
+    sink->written += n;
+}
+
+static void* sink_main(void* arg)
+{
+    AudioSink* sink = (AudioSink*)arg;
+    AudioOut* ao = sink->ao;
+    int16_t* buf = sink->buf;
+    long period_ns = (long)(sink->period * 1e9 / ao->rate);
+    struct timespec next;
+
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while (!sink->stop) {
+        if (sink->realtime) {
+            next.tv_nsec += period_ns;
+            while (next.tv_nsec >= 1000000000L) {
+                next.tv_nsec -= 1000000000L;
+                next.tv_sec++;
+            }
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+        } else if (audioring_count(&ao->ring) < (uint32_t)sink->period) {
+            sched_yield();
+            continue;
+        }
+        audio_out_pull(ao, buf, sink->period);
+        emit(sink, buf, sink->period);
+    }
+
+    /* Offline: the tail shorter than a period is still part of the stream */
+    if (!sink->realtime) {
+        int n = (int)audioring_read(&ao->ring, buf, sink->period);
+        emit(sink, buf, n);
+    }
+    return NULL;
+}
+
+AudioSink* audiosink_start(AudioOut* ao, const char* wav_path, int period, int realtime)
+{
+    AudioSink* sink = (AudioSink*)calloc(1, sizeof(AudioSink));
+
+    if (!sink) return NULL;
+    sink->ao = ao;
+    sink->period = period;
+    sink->realtime = realtime;
+    sink->buf = (int16_t*)malloc(period * sizeof(int16_t));
+    if (!sink->buf) {
+        free(sink);
+        return NULL;
+    }
+    if (wav_path) {
+        sink->wav = fopen(wav_path, "wb");
+        if (!sink->wav) {
+            free(sink->buf);
+            free(sink);
+            return NULL;
+        }
+        wav_write_header(sink->wav, ao->rate, 0);
+    }
+    if (pthread_create(&sink->tid, NULL, sink_main, sink)) {
+        if (sink->wav) fclose(sink->wav);
+        free(sink->buf);
+        free(sink);
+        return NULL;
+    }
+    return sink;
+}
+
+/* Returns the number of samples the sink consumed */
+uint64_t audiosink_stop(AudioSink* sink)
+{
+    uint64_t written;
+
+    if (!sink->realtime) {
+        /* Let the sink catch up with everything queued so far */
+        while (audioring_count(&sink->ao->ring) >= (uint32_t)sink->period)
+            sched_yield();
+    }
+    sink->stop = 1;
+    pthread_join(sink->tid, NULL);
+
+    if (sink->wav) {
+        fseek(sink->wav, 0, SEEK_SET);
+        wav_write_header(sink->wav, sink->ao->rate, (uint32_t)sink->written);
+        fclose(sink->wav);
+    }
+    written = sink->written;
+    free(sink->buf);
+    free(sink);
+    return written;
+}
@@ -0,0 +1,21 @@
+#ifndef AUDIOSINK_H
+#define AUDIOSINK_H
+
+#include <stdio.h>
+#include "audio.h"
+
+/* Host stand-ins for a sound device: a thread that consumes an AudioOut
+ * in fixed periods and either discards the samples (null sink) or writes
+ * them to a 16-bit mono WAV file. A real-time sink pulls one period every
+ * period's worth of wall time, as a device would, and so sees underruns
+ * and overruns; otherwise it pulls whenever a full period is queued,
+ * which records the stream without gaps for offline comparison. */
+
+typedef struct AudioSink AudioSink;
+
+AudioSink* audiosink_start(AudioOut* ao, const char* wav_path, int period, int realtime);
+uint64_t   audiosink_stop(AudioSink* sink);
+
+void wav_write_header(FILE* f, int rate, uint32_t samples);
+
+#endif
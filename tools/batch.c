@@ -0,0 +1,218 @@
+/* Batch runner with work stealing.
+ *
+ * Jobs are dealt out to the workers in contiguous blocks, so a worker
+ * usually runs neighbouring jobs (often the same ROM) back to back. A
+ * worker takes jobs from the front of its own block; once that is empty
+ * it steals the back half of another worker's block. Job lengths can
+ * differ by orders of magnitude (frames, ROM speed), and stealing keeps
+ * every core busy until the last block is drained.
+ */
+#include "batch.h"
+#include "emulator.h"
+#include "cartridge.h"
+#include "hash.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef struct {
+    pthread_mutex_t lock;
+    int lo, hi;             /* jobs not started yet: [lo, hi) */
+} WorkQueue;
+
+typedef struct {
+    BatchJob*  jobs;
+    WorkQueue* queues;
+    int        threads;
+} Pool;
+
+typedef struct {
+    Pool* pool;
+    int   id;
+} Worker;
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int batch_cpu_count(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+}
+
+/* Frame digest: RGB framebuffer, RAM and CPU registers */
+uint64_t batch_frame_hash(const EmulatorState* emu, uint32_t* rgb)
+{
+    const CPU6507* c = &emu->cpu;
+    uint8_t regs[7] = { c->A, c->X, c->Y, c->SP, c->P,
+                        (uint8_t)c->PC, (uint8_t)(c->PC >> 8) };
+    uint64_t h;
+
+    emu_frame_rgb(emu, rgb);
+    h = hash64(rgb, SCREEN_W * SCREEN_H * sizeof(uint32_t));
+    h = hash64_update(h, emu->ram, sizeof(emu->ram));
+    return hash64_update(h, regs, sizeof(regs));
+}
+
+static void run_job(BatchJob* job, EmulatorState* emu, uint32_t* rgb)
+{
+    InputScript script;
+    uint64_t run = HASH64_INIT;
+
+    emu_init(emu);
+    if (!cart_attach_borrowed(emu, job->rom)) {
+        job->ok = 0;
+        return;
+    }
+    emu_reset(emu);
+
+    /* Private cursor over the shared events */
+    if (job->script) {
+        script = *job->script;
+        script_rewind(&script);
+    }
+
+    job->seconds = 0;
+    for (uint32_t f = 0; f < job->frames; f++) {
+        uint64_t h;
+        double t0;
+
+        if (job->script) script_apply(&script, emu, f);
+        t0 = now_sec();
+        emu_run_frame(emu);
+        job->seconds += now_sec() - t0;
+
+        h = batch_frame_hash(emu, rgb);
+        if (job->frame_hashes) job->frame_hashes[f] = h;
+        run = hash64_update(run, &h, sizeof(h));
+    }
+
+    job->ok = 1;
+    job->run_hash = run;
+    job->ram_hash = hash64(emu->ram, sizeof(emu->ram));
+    job->cycles = emu->cpu.cycles;
+    job->instructions = emu->cpu.instructions;
+    cart_unload(emu);
+}
+
+static int take(WorkQueue* q)
+{
+    int i = -1;
+
+    pthread_mutex_lock(&q->lock);
+    if (q->lo < q->hi) i = q->lo++;
+    pthread_mutex_unlock(&q->lock);
+    return i;
+}
+
+/* Move the back half of another worker's block into our (empty) queue
+ * and return its first job, -1 when every queue is empty */
+static int steal(Pool* pool, int self)
+{
+    for (int k = 1; k < pool->threads; k++) {
+        WorkQueue* victim = &pool->queues[(self + k) % pool->threads];
+        int lo, hi;
+
+        pthread_mutex_lock(&victim->lock);
+        hi = victim->hi;
+        lo = hi - (victim->hi - victim->lo + 1) / 2;
+        victim->hi = lo;
+        pthread_mutex_unlock(&victim->lock);
+
+        if (lo < hi) {
+            WorkQueue* own = &pool->queues[self];
+            pthread_mutex_lock(&own->lock);
+            own->lo = lo + 1;
+            own->hi = hi;
+            pthread_mutex_unlock(&own->lock);
+            return lo;
+        }
+    }
+    return -1;
+}
+
+static void* worker_main(void* arg)
+{
+    Worker* w = (Worker*)arg;
+    Pool* pool = w->pool;
+    EmulatorState* emu = malloc(sizeof(EmulatorState));
+    uint32_t* rgb = malloc(SCREEN_W * SCREEN_H * sizeof(uint32_t));
+
+    if (emu && rgb) {
+        for (;;) {
+            int i = take(&pool->queues[w->id]);
+            if (i < 0) i = steal(pool, w->id);
+            if (i < 0) break;
+            run_job(&pool->jobs[i], emu, rgb);
+        }
+    }
+
+    free(rgb);
+    free(emu);
+    return NULL;
+}
+
+/* Run all jobs on `threads` threads (0: one per core). Returns the
+ * number of jobs that could not run (bad ROM image, out of memory). */
+int batch_run(BatchJob* jobs, int count, int threads)
+{
+    Pool pool;
+    Worker* workers;
+    pthread_t* tids;
+    int* started;
+    int failed = 0, running = 0;
+
+    if (threads <= 0) threads = batch_cpu_count();
+    if (threads > count) threads = count;
+    if (threads < 1) return 0;
+
+    for (int i = 0; i < count; i++) jobs[i].ok = 0;
+
+    pool.jobs = jobs;
+    pool.threads = threads;
+    pool.queues = calloc(threads, sizeof(WorkQueue));
+    workers = calloc(threads, sizeof(Worker));
+    tids = calloc(threads, sizeof(pthread_t));
+    started = calloc(threads, sizeof(int));
+    if (!pool.queues || !workers || !tids || !started) {
+        free(pool.queues);
+        free(workers);
+        free(tids);
+        free(started);
+        return count;
+    }
+
+    for (int t = 0; t < threads; t++) {
+        pthread_mutex_init(&pool.queues[t].lock, NULL);
+        pool.queues[t].lo = (int)((int64_t)count * t / threads);
+        pool.queues[t].hi = (int)((int64_t)count * (t + 1) / threads);
+        workers[t].pool = &pool;
+        workers[t].id = t;
+    }
+    for (int t = 0; t < threads; t++) {
+        started[t] = pthread_create(&tids[t], NULL, worker_main, &workers[t]) == 0;
+        running += started[t];
+    }
+    /* The jobs of a worker that did not start are stolen by the others;
+     * with none started, this thread does all of them */
+    if (!running) worker_main(&workers[0]);
+    for (int t = 0; t < threads; t++)
+        if (started[t]) pthread_join(tids[t], NULL);
+
+    for (int t = 0; t < threads; t++)
+        pthread_mutex_destroy(&pool.queues[t].lock);
+    free(pool.queues);
+    free(workers);
+    free(tids);
+    free(started);
+
+    for (int i = 0; i < count; i++)
+        if (!jobs[i].ok) failed++;
+    return failed;
+}
@@ -0,0 +1,33 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "types.h"
+#include "script.h"
+
+/* Batch runner: independent emulator instances spread over a pool of
+ * threads. Everything a job reads (ROM image, script events) is shared
+ * read-only between the jobs that use it; each worker thread owns one
+ * EmulatorState and reuses it for its jobs. The caller holds the ROM
+ * cache references for the whole run. */
+
+typedef struct {
+    /* In */
+    const RomImage*    rom;
+    const InputScript* script;       /* NULL: no input */
+    uint32_t           frames;
+    uint64_t*          frame_hashes; /* optional, one per frame */
+
+    /* Out */
+    int      ok;
+    uint64_t ram_hash;     /* RAM after the last frame */
+    uint64_t run_hash;     /* over all frame hashes */
+    double   seconds;      /* emulation only, without hashing */
+    uint64_t cycles;
+    uint64_t instructions;
+} BatchJob;
+
+int      batch_run(BatchJob* jobs, int count, int threads);
+uint64_t batch_frame_hash(const EmulatorState* emu, uint32_t* rgb);
+int      batch_cpu_count(void);
+
+#endif
@@ -0,0 +1,139 @@
+/* Batch CLI: runs many independent instances of one or more ROMs over
+ * all cores and prints a RAM and frame digest per instance.
+ *
+ *   batchrun <rom>... [--instances N] [--frames N] [--jobs N]
+ *            [--script file] [--seed S] [--quiet]
+ *
+ * Instance i plays the random input of seed S+i (script_random()), or
+ * the --script file when given. ROM files go through the ROM cache, so
+ * each distinct image is in memory once, shared by all of its
+ * instances. Output: one line per instance with ROM, instance, RAM hash
+ * and run hash (over all frame hashes), then a summary on stderr.
+ */
+#include "batch.h"
+#include "romcache.h"
+#include "script.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_ROMS 64
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void usage(const char* prog)
+{
+    fprintf(stderr, "usage: %s <rom>... [--instances N] [--frames N] [--jobs N]\n"
+                    "       [--script file] [--seed S] [--quiet]\n", prog);
+}
+
+int main(int argc, char** argv)
+{
+    const char* roms[MAX_ROMS];
+    RomImage* images[MAX_ROMS];
+    int rom_count = 0;
+    const char* script_path = NULL;
+    int instances = 100, jobs = 0, quiet = 0;
+    uint32_t frames = 600, seed = 1;
+    InputScript shared;
+    InputScript* scripts = NULL;
+    BatchJob* batch;
+    int count, failed;
+    double t0, wall, emu_seconds = 0;
+    uint64_t cycles = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--instances") && i + 1 < argc) instances = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--frames") && i + 1 < argc) frames = (uint32_t)strtoul(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "--jobs") && i + 1 < argc) jobs = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--script") && i + 1 < argc) script_path = argv[++i];
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc) seed = (uint32_t)strtoul(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "--quiet")) quiet = 1;
+        else if (argv[i][0] == '-' || rom_count == MAX_ROMS) { usage(argv[0]); return 2; }
+        else roms[rom_count++] = argv[i];
+    }
+    if (!rom_count || instances < 1 || !frames) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    for (int r = 0; r < rom_count; r++) {
+        images[r] = romcache_open(roms[r]);
+        if (!images[r]) {
+            fprintf(stderr, "cannot read %s\n", roms[r]);
+            return 2;
+        }
+    }
+
+    if (script_path) {
+        if (!script_load(&shared, script_path)) return 2;
+    } else {
+        scripts = calloc(instances, sizeof(InputScript));
+        if (!scripts) {
+            fprintf(stderr, "out of memory\n");
+            return 2;
+        }
+        for (int i = 0; i < instances; i++)
+            script_random(&scripts[i], frames, seed + i);
+    }
+
+    count = rom_count * instances;
+    batch = calloc(count, sizeof(BatchJob));
+    if (!batch) {
+        fprintf(stderr, "out of memory\n");
+        return 2;
+    }
+    for (int r = 0; r < rom_count; r++) {
+        for (int i = 0; i < instances; i++) {
+            BatchJob* job = &batch[r * instances + i];
+            job->rom = images[r];
+            job->script = scripts ? &scripts[i] : &shared;
+            job->frames = frames;
+        }
+    }
+
+    if (jobs <= 0) jobs = batch_cpu_count();
+    t0 = now_sec();
+    failed = batch_run(batch, count, jobs);
+    wall = now_sec() - t0;
+
+    for (int j = 0; j < count; j++) {
+        const BatchJob* job = &batch[j];
+        if (!quiet) {
+            if (job->ok)
+                printf("%s %d %016llx %016llx\n", roms[j / instances], j % instances,
+                       (unsigned long long)job->ram_hash, (unsigned long long)job->run_hash);
+            else
+                printf("%s %d error\n", roms[j / instances], j % instances);
+        }
+        emu_seconds += job->seconds;
+        cycles += job->cycles;
+    }
+
+    fprintf(stderr, "%d instances (%d ROMs x %d), %u frames each, %d threads\n",
+            count, rom_count, instances, frames, jobs);
+    fprintf(stderr, "wall %.3f s, %.0f frames/s total, %.0f frames/s per thread, "
+                    "%.1f M cycles/s\n",
+            wall, (double)count * frames / wall,
+            emu_seconds > 0 ? (double)(count - failed) * frames / emu_seconds : 0.0,
+            cycles / wall / 1e6);
+    fprintf(stderr, "%d ROM images, %zu bytes of ROM shared by %d instances\n",
+            romcache_count(), romcache_bytes(), count);
+    if (failed) fprintf(stderr, "%d instances failed\n", failed);
+
+    if (scripts) {
+        for (int i = 0; i < instances; i++) script_free(&scripts[i]);
+        free(scripts);
+    } else {
+        script_free(&shared);
+    }
+    for (int r = 0; r < rom_count; r++) romcache_release(images[r]);
+    free(batch);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,330 @@
+/* Frame benchmark: runs a ROM headless for N frames with scripted input
+ * and reports emulation speed.
+ *
+ *   bench <rom> [frames] [--script file] [--lockstep]  [--pixel] [--rewind kb]
+ *         [--run-ahead n] [--render-off] [--no-audio] [--wav file]
+ *         [--audio-out] [--rate hz] [--profile file]
+ *
+ * Without --script a built-in input pattern is used, so every run of the
+ * same ROM and frame count executes the same instructions. Afterwards
+ * the save state size and save/load latency are measured on the final
+ * state. --rewind records every frame into a rewind buffer of the given
+ * size and reports its cost. --run-ahead emulates n extra frames per shown
+ * frame, so its cost is the difference in fps against a run without it.
+ * --render-off runs every frame hidden, as fast-forward and frame skip do.
+ * --no-audio stops storing sound samples, so the difference in fps against
+ * a normal run is the cost of audio. --wav sends the sound through the
+ * audio output stage (resampler and queue) to a WAV file at --rate Hz,
+ * without gaps. --audio-out does the same into a null sink that plays in
+ * real time, with the frames paced to the sound, and reports underruns,
+ * overruns and latency; it takes as long as the frames would on a TV.
+ * Built with PROFILE=1 it also prints the opcode mix and hottest ROM
+ * locations of the run, and --profile writes the flat profile to a file.
+ * The startup cost of identifying the cartridge (MD5, ROM database lookup,
+ * signature scan, whole cart_load()) is reported as well.
+ */
+#include "emulator.h"
+#include "audio.h"
+#include "audiosink.h"
+#include "cartridge.h"
+#include "tia.h"
+#include "rewind.h"
+#include "romdb.h"
+#include "savestate.h"
+#include "script.h"
+#include "profile.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <sched.h>
+#include <string.h>
+#include <time.h>
+
+static EmulatorState emu;
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void sleep_until(double t)
+{
+    double d = t - now_sec();
+    struct timespec ts;
+
+    if (d <= 0) return;
+    ts.tv_sec = (time_t)d;
+    ts.tv_nsec = (long)((d - ts.tv_sec) * 1e9);
+    nanosleep(&ts, NULL);
+}
+
+#define STATE_ITERS 100000
+#define AUDIO_PERIOD 512
+#define REWIND_INTERVAL 60
+
+/* Average save and load time of the current state, in ns */
+static size_t bench_states(double* save_ns, double* load_ns)
+{
+    static uint8_t buf[SAVESTATE_MAX_SIZE];
+    size_t size = 0;
+    double t0;
+    int i;
+
+    t0 = now_sec();
+    for (i = 0; i < STATE_ITERS; i++)
+        size = savestate_save(&emu, buf, sizeof(buf));
+    *save_ns = (now_sec() - t0) * 1e9 / STATE_ITERS;
+
+    t0 = now_sec();
+    for (i = 0; i < STATE_ITERS; i++)
+        if (!savestate_load(&emu, buf, size)) return 0;
+    *load_ns = (now_sec() - t0) * 1e9 / STATE_ITERS;
+    return size;
+}
+
+#define DETECT_ITERS 200
+
+/* Average cart_load() time in us, MD5 of the image in us, database
+ * lookup (hits and misses) in ns and signature scan in us, on a scratch
+ * instance */
+static void bench_detect(const char* rom, double* load_us, double* md5_us, double* lookup_ns,
+                         double* scan_us)
+{
+    static EmulatorState scratch;
+    const Cartridge* cart = &emu.cart;
+    volatile uintptr_t sink = 0;
+    uint8_t digest[2][MD5_SIZE];
+    double t0;
+    int i, sc;
+
+    emu_init(&scratch);
+    t0 = now_sec();
+    for (i = 0; i < DETECT_ITERS; i++)
+        cart_load(&scratch, rom);
+    *load_us = (now_sec() - t0) * 1e6 / DETECT_ITERS;
+    emu_shutdown(&scratch);
+
+    t0 = now_sec();
+    for (i = 0; i < DETECT_ITERS; i++)
+        md5(cart->rom, cart->rom_size, digest[0]);
+    *md5_us = (now_sec() - t0) * 1e6 / DETECT_ITERS;
+
+    memcpy(digest[1], digest[0], MD5_SIZE);
+    digest[1][MD5_SIZE - 1] ^= 1;
+    t0 = now_sec();
+    for (i = 0; i < STATE_ITERS; i++)
+        sink += (uintptr_t)romdb_lookup(digest[i & 1], cart->rom_size);
+    *lookup_ns = (now_sec() - t0) * 1e9 / STATE_ITERS;
+
+    t0 = now_sec();
+    for (i = 0; i < DETECT_ITERS; i++)
+        sink += cart_detect(cart->rom, cart->rom_size, &sc);
+    *scan_us = (now_sec() - t0) * 1e6 / DETECT_ITERS;
+    (void)sink;
+}
+
+static void usage(const char* prog)
+{
+    fprintf(stderr, "usage: %s <rom> [frames] [--script file] [--lockstep] [--pixel]\n"
+            "       [--rewind kb] [--run-ahead n] [--render-off] [--no-audio] [--wav file]\n"
+            "       [--audio-out] [--rate hz] [--profile file]\n", prog);
+}
+
+int main(int argc, char** argv)
+{
+    const char* rom = NULL;
+    const char* script_path = NULL;
+    uint32_t frames = 3000;
+    int lockstep = 0, pixel = 0;
+    uint32_t rewind_kb = 0;
+    int run_ahead = 0, render_off = 0, no_audio = 0;
+    const char* wav_path = NULL;
+    int audio_rt = 0, rate = 48000;
+    uint64_t samples = 0;
+    double audio_time = 0;
+    static AudioOut ao;
+    AudioSink* sink = NULL;
+    uint64_t sunk = 0;
+    const char* profile_path = NULL;
+    double push_time = 0;
+    InputScript script;
+    static Rewind rw;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--script") && i + 1 < argc) script_path = argv[++i];
+        else if (!strcmp(argv[i], "--lockstep")) lockstep = 1;
+        else if (!strcmp(argv[i], "--pixel")) pixel = 1;
+        else if (!strcmp(argv[i], "--rewind") && i + 1 < argc)
+            rewind_kb = (uint32_t)strtoul(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "--run-ahead") && i + 1 < argc)
+            run_ahead = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--render-off")) render_off = 1;
+        else if (!strcmp(argv[i], "--no-audio")) no_audio = 1;
+        else if (!strcmp(argv[i], "--wav") && i + 1 < argc) wav_path = argv[++i];
+        else if (!strcmp(argv[i], "--audio-out")) audio_rt = 1;
+        else if (!strcmp(argv[i], "--rate") && i + 1 < argc) rate = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--profile") && i + 1 < argc) profile_path = argv[++i];
+        else if (argv[i][0] == '-') { usage(argv[0]); return 1; }
+        else if (!rom) rom = argv[i];
+        else frames = (uint32_t)strtoul(argv[i], NULL, 0);
+    }
+    if (!rom || !frames) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (script_path) {
+        if (!script_load(&script, script_path)) return 1;
+    } else {
+        script_default(&script, frames);
+    }
+
+    emu_init(&emu);
+    if (!cart_load(&emu, rom)) {
+        fprintf(stderr, "cannot load %s\n", rom);
+        return 1;
+    }
+    emu_reset(&emu);
+#ifdef CPU_PROFILE
+    if (!profile_init(&emu)) {
+        fprintf(stderr, "cannot allocate the profile\n");
+        return 1;
+    }
+#else
+    if (profile_path) {
+        fprintf(stderr, "--profile needs a build with PROFILE=1\n");
+        return 1;
+    }
+#endif
+    if (lockstep) emu_set_sched_mode(&emu, EMU_SCHED_LOCKSTEP);
+    if (pixel) tia_set_render_mode(&emu, TIA_RENDER_PIXEL);
+    emu_set_run_ahead(&emu, run_ahead);
+    if (render_off) tia_set_render_off(&emu, 1);
+    if (no_audio) tia_set_audio_off(&emu, 1);
+    if (wav_path || audio_rt) {
+        /* Four frames of queue, a period of about 10 ms */
+        if (!audio_out_init(&ao, rate, rate * 4 / 60)) {
+            fprintf(stderr, "bad output rate %d\n", rate);
+            return 1;
+        }
+        if (!audio_rt) sink = audiosink_start(&ao, wav_path, AUDIO_PERIOD, 0);
+        if (!audio_rt && !sink) {
+            fprintf(stderr, "cannot write %s\n", wav_path);
+            return 1;
+        }
+    }
+    if (rewind_kb && !rewind_init(&rw, (size_t)rewind_kb * 1024, REWIND_INTERVAL)) {
+        fprintf(stderr, "cannot allocate %u KB of rewind buffer\n", rewind_kb);
+        return 1;
+    }
+
+    double t0 = now_sec();
+    for (uint32_t f = 0; f < frames; f++) {
+        script_apply(&script, &emu, f);
+        if (rewind_kb) {
+            double t = now_sec();
+            rewind_push(&rw, &emu);
+            push_time += now_sec() - t;
+        }
+        emu_run_frame(&emu);
+        samples += emu.tia.audio_len;
+        if (wav_path || audio_rt) {
+            double t;
+            /* Offline the stream must be complete, so wait for room
+             * (outside the timed part); a real device never waits */
+            while (!audio_rt && !audio_out_fits(&ao, emu.tia.audio_len))
+                sched_yield();
+            t = now_sec();
+            audio_out_frame(&ao, &emu);
+            audio_time += now_sec() - t;
+        }
+        if (audio_rt) {
+            /* Start playing with two frames queued, then keep pace */
+            if (f == 1) sink = audiosink_start(&ao, wav_path, AUDIO_PERIOD, 1);
+            sleep_until(t0 + (double)samples / TIA_SAMPLE_RATE);
+        }
+    }
+    double dt = now_sec() - t0;
+
+    if (sink) sunk = audiosink_stop(sink);
+
+    uint64_t cycles = emu.cpu.cycles;
+    uint64_t instr = emu.cpu.instructions;
+    double save_ns = 0, load_ns = 0;
+    size_t state = bench_states(&save_ns, &load_ns);
+    double load_us, md5_us, lookup_ns, scan_us;
+
+    bench_detect(rom, &load_us, &md5_us, &lookup_ns, &scan_us);
+
+    printf("rom          %s\n", rom);
+    printf("cart         %s, %s, %s (%d ROMs in database)\n", cart_type_name(&emu.cart),
+           emu.cart.tv == TV_PAL ? "PAL" : "NTSC",
+           emu.cart.known ? "from database" : "guessed", romdb_count());
+    printf("detect       load %.1f us, md5 %.1f us, database lookup %.0f ns, "
+           "signature scan %.1f us\n", load_us, md5_us, lookup_ns, scan_us);
+    printf("mode         %s, %s", lockstep ? "lock-step" : "batch",
+           pixel ? "pixel" : "span");
+    if (run_ahead) printf(", run-ahead %d", run_ahead);
+    if (render_off) printf(", render off");
+    if (no_audio) printf(", no audio");
+    if (audio_rt) printf(", real time");
+    printf("\n");
+    printf("frames       %u in %.3f s (%.1f us/frame)\n", frames, dt, dt * 1e6 / frames);
+    printf("fps          %.1f (%.1fx real time)\n", frames / dt, frames / dt / 60.0);
+    printf("audio        %.1f samples/frame at %d Hz\n", (double)samples / frames,
+           TIA_SAMPLE_RATE);
+    if (wav_path || audio_rt) {
+        double lat_min, lat_avg, lat_max;
+
+        audio_out_latency(&ao, &lat_min, &lat_avg, &lat_max);
+        printf("audio out    %d Hz, %llu samples to %s, resample %.1f ns/sample "
+               "(%.2f%% of frame time)\n", rate, (unsigned long long)sunk,
+               wav_path ? wav_path : "null sink",
+               ao.produced ? audio_time * 1e9 / ao.produced : 0.0, audio_time * 100.0 / dt);
+        printf("audio queue  %u underruns (%llu samples), %u overruns (%llu samples)\n",
+               ao.underruns, (unsigned long long)ao.missing,
+               ao.overruns, (unsigned long long)ao.dropped);
+        printf("latency      %.1f ms min, %.1f avg, %.1f max\n", lat_min, lat_avg, lat_max);
+        audio_out_free(&ao);
+    }
+    printf("cycles/s     %.2f M (%.1fx 1.19 MHz)\n", cycles / dt / 1e6,
+           cycles / dt / 1193182.0);
+    printf("ns/instr     %.2f (%llu instructions)\n",
+           instr ? dt * 1e9 / instr : 0.0, (unsigned long long)instr);
+    if (state)
+        printf("save state   %u bytes, save %.0f ns, load %.0f ns\n",
+               (unsigned)state, save_ns, load_ns);
+    else
+        printf("save state   failed\n");
+
+    if (rewind_kb) {
+        int held = rw.count;
+        double t = now_sec();
+        while (rewind_pop(&rw) && rewind_peek(&rw, &emu))
+            ;
+        double restore_ns = held > 1 ? (now_sec() - t) * 1e9 / (held - 1) : 0.0;
+
+        printf("rewind       %u KB: %d frames held (%.1f s), %.1f bytes/frame\n",
+               rewind_kb, held, held / 60.0,
+               rw.pushed ? (double)rw.pushed_bytes / rw.pushed : 0.0);
+        printf("rewind cost  push %.0f ns/frame (%.2f%% of frame time), restore %.0f ns\n",
+               push_time * 1e9 / frames, push_time * 100.0 / dt, restore_ns);
+        rewind_free(&rw);
+    }
+
+#ifdef CPU_PROFILE
+    profile_report(&emu, stdout, 20);
+    if (profile_path) {
+        if (!profile_dump(&emu, profile_path)) {
+            fprintf(stderr, "cannot write %s\n", profile_path);
+            return 1;
+        }
+        printf("profile      written to %s\n", profile_path);
+    }
+#endif
+
+    script_free(&script);
+    emu_shutdown(&emu);
+    return 0;
+}
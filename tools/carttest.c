@@ -0,0 +1,426 @@
+/* Cartridge scheme test: builds a synthetic image for every bankswitch
+ * scheme, checks that cart_detect() recognizes it and that the hotspots,
+ * bus hooks and RAM ports show the expected bytes in the window.
+ *
+ *   carttest
+ *
+ * Every byte of an image holds the number of its bank, so a read tells
+ * which bank a window address shows. Images of schemes found by their
+ * code carry one of the signatures cart_detect() looks for, which also
+ * keeps them from looking like Superchip images. Exits with 1 if any
+ * check fails.
+ */
+#include "emulator.h"
+#include "cartridge.h"
+#include "cpu6507.h"
+#include "romdb.h"
+#include "savestate.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static EmulatorState emu;
+static const char* scheme;
+static int checks, failures;
+
+#define CHECK(cond) check((cond), #cond, __LINE__)
+
+static void check(int ok, const char* what, int line)
+{
+    checks++;
+    if (!ok) {
+        printf("FAIL %s line %d: %s\n", scheme, line, what);
+        failures++;
+    }
+}
+
+/* size bytes, each one the number of its bank_size bank, with sig at
+ * offset 100 of the first bank */
+static uint8_t* image(uint32_t size, uint32_t bank_size, const uint8_t* sig, int sig_len)
+{
+    uint8_t* data = malloc(size);
+
+    if (!data) {
+        printf("out of memory\n");
+        exit(1);
+    }
+    for (uint32_t i = 0; i < size; i++) data[i] = (uint8_t)(i / bank_size);
+    if (sig) memcpy(data + 100, sig, sig_len);
+    return data;
+}
+
+/* Detect and attach the image, expecting the given scheme */
+static void load(const uint8_t* data, uint32_t size, CartType type, int superchip)
+{
+    int sc;
+
+    CHECK(cart_detect(data, size, &sc) == type);
+    CHECK(sc == superchip);
+    CHECK(cart_load_image(&emu, data, size));
+    CHECK(emu.cart.type == type);
+    CHECK(emu.cart.superchip == superchip);
+}
+
+static void done(uint8_t* data)
+{
+    cart_unload(&emu);
+    free(data);
+}
+
+/* F8, F6, F4: 4K banks, a read or write of hot_lo + i selects bank i,
+ * the last bank at power on. With a Superchip, the first 256 bytes of
+ * every bank are one filler value and hold the RAM ports. */
+static void test_atari(CartType type, int banks, uint16_t hot_lo, int superchip)
+{
+    uint32_t size = (uint32_t)banks * 4096;
+    uint8_t* data = image(size, 4096, NULL, 0);
+
+    if (!superchip) data[1] = 0xEA;
+    load(data, size, type, superchip);
+    CHECK(emu.cart.num_banks == banks);
+    CHECK(cart_bank_size(&emu.cart) == 4096);
+    CHECK(mem_read(&emu, 0x1200) == banks - 1);
+    CHECK(mem_read(&emu, 0x1FFF) == banks - 1);
+    for (int bank = 0; bank < banks; bank++) {
+        if (bank & 1) mem_write(&emu, (uint16_t)(0x1000 + hot_lo + bank), 0);
+        else          mem_read(&emu, (uint16_t)(0x1000 + hot_lo + bank));
+        CHECK(mem_read(&emu, 0x1200) == bank);
+        CHECK(mem_read(&emu, 0xF800) == bank);  /* mirrors */
+    }
+
+    if (superchip) {
+        /* Write port 0x000-0x07F, read port 0x080-0x0FF */
+        mem_write(&emu, 0x1000, 0x12);
+        mem_write(&emu, 0x107F, 0x34);
+        CHECK(mem_read(&emu, 0x1080) == 0x12);
+        CHECK(mem_read(&emu, 0x10FF) == 0x34);
+        mem_write(&emu, 0x1081, 0x56);
+        CHECK(mem_read(&emu, 0x1081) == 0);
+        mem_read(&emu, (uint16_t)(0x1000 + hot_lo));
+        CHECK(mem_read(&emu, 0x1080) == 0x12);
+        CHECK(mem_read(&emu, 0x1100) == 0);
+    }
+    done(data);
+}
+
+/* FA: three 4K banks at 0xFF8-0xFFA, 256 bytes of RAM written at
+ * 0x000-0x0FF and read at 0x100-0x1FF */
+static void test_fa(void)
+{
+    uint8_t* data = image(12288, 4096, NULL, 0);
+
+    load(data, 12288, CART_FA, 0);
+    CHECK(mem_read(&emu, 0x1800) == 2);
+    mem_read(&emu, 0x1FF8);
+    CHECK(mem_read(&emu, 0x1800) == 0);
+    mem_write(&emu, 0x1FF9, 0);
+    CHECK(mem_read(&emu, 0x1800) == 1);
+
+    mem_write(&emu, 0x1000, 0xA5);
+    mem_write(&emu, 0x10FF, 0x5A);
+    CHECK(mem_read(&emu, 0x1100) == 0xA5);
+    CHECK(mem_read(&emu, 0x11FF) == 0x5A);
+    mem_read(&emu, 0x1FFA);
+    CHECK(mem_read(&emu, 0x1100) == 0xA5);
+    CHECK(mem_read(&emu, 0x1200) == 2);
+    done(data);
+}
+
+/* E0: three switchable 1K slices at 0x000, 0x400 and 0x800, the last 1K
+ * of the image fixed at 0xC00 */
+static void test_e0(void)
+{
+    static const uint8_t sig[] = { 0xAD, 0xE0, 0x1F };   /* LDA $1FE0 */
+    uint8_t* data = image(8192, 1024, sig, sizeof(sig));
+
+    load(data, 8192, CART_E0, 0);
+    CHECK(cart_bank_size(&emu.cart) == 1024);
+    CHECK(mem_read(&emu, 0x1200) == 4);
+    CHECK(mem_read(&emu, 0x1600) == 5);
+    CHECK(mem_read(&emu, 0x1A00) == 6);
+    CHECK(mem_read(&emu, 0x1E00) == 7);
+
+    mem_read(&emu, 0x1FE2);
+    mem_read(&emu, 0x1FE9);
+    mem_write(&emu, 0x1FF3, 0);
+    CHECK(mem_read(&emu, 0x1200) == 2);
+    CHECK(mem_read(&emu, 0x1600) == 1);
+    CHECK(mem_read(&emu, 0x1A00) == 3);
+    CHECK(mem_read(&emu, 0x1FD0) == 7);
+    CHECK(mem_read(&emu, 0xF200) == 2);
+
+    /* Every bank reaches every slot */
+    for (int bank = 0; bank < 8; bank++) {
+        mem_read(&emu, (uint16_t)(0x1FE0 + bank));
+        mem_read(&emu, (uint16_t)(0x1FE8 + (7 - bank)));
+        mem_read(&emu, (uint16_t)(0x1FF0 + bank));
+        CHECK(mem_read(&emu, 0x1000) == bank);
+        CHECK(mem_read(&emu, 0x17FF) == 7 - bank);
+        CHECK(mem_read(&emu, 0x1800) == bank);
+    }
+    done(data);
+}
+
+/* E7: 2K ROM banks 0-6 at 0x000 (0xFE0-0xFE6) or the 1K RAM (0xFE7,
+ * written at 0x000, read at 0x400); one of four 256-byte RAM banks
+ * (0xFE8-0xFEB) written at 0x800, read at 0x900; the rest of the last
+ * 2K bank fixed at 0xA00 */
+static void test_e7(void)
+{
+    static const uint8_t sig[] = { 0xAD, 0xE2, 0xFF };   /* LDA $FFE2 */
+    uint8_t* data = image(16384, 2048, sig, sizeof(sig));
+    uint8_t state[SAVESTATE_MAX_SIZE];
+    size_t len;
+
+    load(data, 16384, CART_E7, 0);
+    CHECK(cart_bank_size(&emu.cart) == 2048);
+    CHECK(mem_read(&emu, 0x1000) == 0);
+    CHECK(mem_read(&emu, 0x1A00) == 7);
+    CHECK(mem_read(&emu, 0x1FF0) == 7);
+    for (int bank = 0; bank < 7; bank++) {
+        mem_read(&emu, (uint16_t)(0x1FE0 + bank));
+        CHECK(mem_read(&emu, 0x1700) == bank);
+    }
+
+    mem_read(&emu, 0x1FE7);
+    mem_write(&emu, 0x1010, 0xAA);
+    mem_write(&emu, 0x13FF, 0xBB);
+    CHECK(mem_read(&emu, 0x1410) == 0xAA);
+    CHECK(mem_read(&emu, 0x17FF) == 0xBB);
+    mem_write(&emu, 0x1411, 0xCC);
+    CHECK(mem_read(&emu, 0x1411) == 0);
+
+    for (int ram = 0; ram < 4; ram++) {
+        mem_read(&emu, (uint16_t)(0x1FE8 + ram));
+        mem_write(&emu, 0x1820, (uint8_t)(0x50 + ram));
+    }
+    for (int ram = 0; ram < 4; ram++) {
+        mem_write(&emu, (uint16_t)(0x1FE8 + ram), 0);
+        CHECK(mem_read(&emu, 0x1920) == 0x50 + ram);
+    }
+
+    /* The RAM and both selections go through a save state */
+    len = savestate_save(&emu, state, sizeof(state));
+    CHECK(len == savestate_size(&emu));
+    mem_read(&emu, 0x1FE0);
+    mem_read(&emu, 0x1FE8);
+    mem_write(&emu, 0x1820, 0);
+    CHECK(savestate_load(&emu, state, len));
+    CHECK(mem_read(&emu, 0x1410) == 0xAA);
+    CHECK(mem_read(&emu, 0x1920) == 0x53);
+    done(data);
+}
+
+/* 3F: a write to 0x00-0x3F selects the 2K bank at 0x000, the last 2K of
+ * the image is fixed at 0x800; up to 256 banks */
+static void test_3f(void)
+{
+    static const uint8_t sig[] = { 0x85, 0x3F, 0x85, 0x3F };   /* STA $3F */
+    uint8_t* data = image(32768, 2048, sig, sizeof(sig));
+
+    load(data, 32768, CART_3F, 0);
+    CHECK(cart_bank_size(&emu.cart) == 2048);
+    CHECK(emu.cart.num_banks == 16);
+    CHECK(mem_read(&emu, 0x1000) == 0);
+    CHECK(mem_read(&emu, 0x1800) == 15);
+    mem_write(&emu, 0x003F, 5);
+    CHECK(mem_read(&emu, 0x1000) == 5);
+    mem_write(&emu, 0x0002, 7);
+    CHECK(mem_read(&emu, 0x1000) == 7);
+    mem_write(&emu, 0x0040, 3);
+    CHECK(mem_read(&emu, 0x1000) == 7);
+    mem_read(&emu, 0x003F);
+    CHECK(mem_read(&emu, 0x1000) == 7);
+    mem_write(&emu, 0x003F, 21);   /* wraps */
+    CHECK(mem_read(&emu, 0x1000) == 5);
+    done(data);
+
+    data = image(CART_MAX_ROM_SIZE, 2048, sig, sizeof(sig));
+    load(data, CART_MAX_ROM_SIZE, CART_3F, 0);
+    CHECK(emu.cart.num_banks == 256);
+    mem_write(&emu, 0x003F, 200);
+    CHECK(mem_read(&emu, 0x1000) == 200);
+    CHECK(mem_read(&emu, 0x1FFF) == 255);
+    done(data);
+}
+
+/* UA: any access to 0x220 selects bank 0, to 0x240 bank 1 */
+static void test_ua(void)
+{
+    static const uint8_t sig[] = { 0x8D, 0x40, 0x02 };   /* STA $0240 */
+    uint8_t* data = image(8192, 4096, sig, sizeof(sig));
+
+    load(data, 8192, CART_UA, 0);
+    CHECK(mem_read(&emu, 0x1000) == 0);
+    mem_read(&emu, 0x0240);
+    CHECK(mem_read(&emu, 0x1000) == 1);
+    mem_write(&emu, 0x0220, 0);
+    CHECK(mem_read(&emu, 0x1000) == 0);
+    mem_write(&emu, 0x0240, 0);
+    CHECK(mem_read(&emu, 0x1FFF) == 1);
+    mem_read(&emu, 0x0280);
+    CHECK(mem_read(&emu, 0x1FFF) == 1);
+    done(data);
+}
+
+/* CV: 1K RAM read at 0x000-0x3FF and written at 0x400-0x7FF, the last
+ * 2K of the image at 0x800 */
+static void test_cv(uint32_t size)
+{
+    static const uint8_t sig[] = { 0x9D, 0xFF, 0xF3 };   /* STA $F3FF,X */
+    uint8_t* data = image(size, 2048, sig, sizeof(sig));
+
+    load(data, size, CART_CV, 0);
+    mem_write(&emu, 0x1405, 0x77);
+    mem_write(&emu, 0x17FF, 0x88);
+    CHECK(mem_read(&emu, 0x1005) == 0x77);
+    CHECK(mem_read(&emu, 0x13FF) == 0x88);
+    mem_write(&emu, 0x1006, 0x99);
+    CHECK(mem_read(&emu, 0x1006) == 0);
+    CHECK(mem_read(&emu, 0x1900) == size / 2048 - 1);
+    if (size == 2048) CHECK(mem_read(&emu, 0x1800 + 100) == 0x9D);
+    done(data);
+}
+
+/* FE: the bank follows JSR/RTS targets, 0xFxxx bank 0 and 0xDxxx bank 1.
+ * Bank 0 calls a subroutine in bank 1 and goes on after its RTS. */
+static void test_fe(void)
+{
+    static const uint8_t bank0[] = {
+        0x20, 0x00, 0xD0,   /* F000 JSR $D000 (also the detection signature) */
+        0xC6, 0xC5,         /* F003 DEC $C5 */
+        0xA9, 0x33,         /* F005 LDA #$33 */
+        0x85, 0x81,         /* F007 STA $81 */
+        0x4C, 0x09, 0xF0,   /* F009 JMP $F009 */
+    };
+    static const uint8_t bank1[] = {
+        0xA9, 0x42,         /* D000 LDA #$42 */
+        0x85, 0x80,         /* D002 STA $80 */
+        0x60,               /* D004 RTS */
+    };
+    uint8_t* data = image(8192, 4096, NULL, 0);
+
+    memcpy(data, bank0, sizeof(bank0));
+    memcpy(data + 4096, bank1, sizeof(bank1));
+    data[0x0FFC] = 0x00;
+    data[0x0FFD] = 0xF0;
+    data[0x1FFC] = 0x00;
+    data[0x1FFD] = 0xD0;
+
+    load(data, 8192, CART_FE, 0);
+    emu_reset(&emu);
+    CHECK(emu.cpu.PC == 0xF000);
+    emu_run_frame(&emu);
+    CHECK(emu.ram[0] == 0x42);
+    CHECK(emu.ram[1] == 0x33);
+    CHECK(emu.ram[0x45] == 0xFF);
+    CHECK(emu.cart.bank[0] == 0);
+    done(data);
+}
+
+/* cart_set_type(): refuses images too small for the scheme and Superchip
+ * RAM outside F8/F6/F4, leaving the cartridge as it was */
+static void test_set_type(void)
+{
+    uint8_t* data = image(8192, 1024, NULL, 0);
+
+    data[1] = 0xEA;
+    load(data, 8192, CART_F8, 0);
+    CHECK(!cart_set_type(&emu, CART_E7, 0));
+    CHECK(emu.cart.type == CART_F8);
+    CHECK(mem_read(&emu, 0x1000) == 4);
+    CHECK(!cart_set_type(&emu, CART_E0, 1));
+    CHECK(cart_set_type(&emu, CART_E0, 0));
+    CHECK(mem_read(&emu, 0x1000) == 4);
+    CHECK(mem_read(&emu, 0x1C00) == 7);
+    CHECK(cart_set_type(&emu, CART_F8, 1));
+    CHECK(emu.cart.superchip);
+    mem_write(&emu, 0x1000, 0x21);
+    CHECK(mem_read(&emu, 0x1080) == 0x21);
+    done(data);
+}
+
+/* 2K images show twice in the window; other images under 4K fit no
+ * scheme and fail to load, leaving no cartridge */
+static void test_small(void)
+{
+    uint8_t* data = image(4096, 1024, NULL, 0);
+
+    load(data, 2048, CART_2K, 0);
+    CHECK(mem_read(&emu, 0x1400) == 1);
+    CHECK(mem_read(&emu, 0x1C00) == 1);
+    CHECK(!cart_load_image(&emu, data, 3000));
+    CHECK(emu.cart.rom == NULL);
+    CHECK(mem_read(&emu, 0x1FFC) == 0xFF);
+    load(data, 4096, CART_4K, 0);
+    CHECK(mem_read(&emu, 0x1C00) == 3);
+    done(data);
+}
+
+/* ROM database: the table is sorted, so a binary search finds the first,
+ * middle and last entries of tools/romdb.txt with their TV format */
+static void test_romdb(void)
+{
+    static const struct {
+        uint8_t  md5[MD5_SIZE];
+        uint32_t size;
+        CartType type;
+        TvFormat tv;
+    } known[] = {
+        { { 0x08,0x1e,0x2c,0x11,0x4c,0x9c,0x20,0xb6,0x1a,0xcf,0x25,0xfc,0x95,0xc7,0x1b,0xf4 },
+          8192, CART_E0, TV_NTSC },     /* Frogger II */
+        { { 0x76,0xf5,0x3a,0xbb,0xbf,0x39,0xa0,0x06,0x3f,0x24,0x03,0x6d,0x6e,0xe0,0x96,0x8a },
+          16384, CART_E7, TV_NTSC },    /* Bump 'n' Jump */
+        { { 0x88,0x32,0x58,0xdc,0xd6,0x8c,0xef,0xc6,0xcd,0x4d,0x40,0xb1,0x18,0x51,0x16,0xdc },
+          8192, CART_FE, TV_PAL },      /* Decathlon (PAL) */
+        { { 0xfb,0xb0,0x15,0x1e,0xa2,0x10,0x8e,0x33,0xb2,0xdb,0xaa,0xe1,0x4a,0x18,0x31,0xdd },
+          8192, CART_FE, TV_PAL },      /* Robot Tank (PAL) */
+    };
+    uint8_t other[MD5_SIZE];
+
+    CHECK(romdb_count() >= 4);
+    for (int i = 0; i < 4; i++) {
+        const RomDbEntry* e = romdb_lookup(known[i].md5, known[i].size);
+        CHECK(e != NULL);
+        if (!e) continue;
+        CHECK(e->type == known[i].type);
+        CHECK(e->tv == known[i].tv);
+        CHECK(!e->superchip);
+        CHECK(romdb_lookup(known[i].md5, known[i].size * 2) == NULL);
+        memcpy(other, known[i].md5, MD5_SIZE);
+        other[MD5_SIZE - 1] ^= 1;
+        CHECK(romdb_lookup(other, known[i].size) == NULL);
+    }
+}
+
+int main(void)
+{
+    emu_init(&emu);
+
+    scheme = "F8";   test_atari(CART_F8, 2, 0xFF8, 0);
+    scheme = "F8SC"; test_atari(CART_F8, 2, 0xFF8, 1);
+    scheme = "F6";   test_atari(CART_F6, 4, 0xFF6, 0);
+    scheme = "F6SC"; test_atari(CART_F6, 4, 0xFF6, 1);
+    scheme = "F4";   test_atari(CART_F4, 8, 0xFF4, 0);
+    scheme = "F4SC"; test_atari(CART_F4, 8, 0xFF4, 1);
+    scheme = "FA";   test_fa();
+    scheme = "E0";   test_e0();
+    scheme = "E7";   test_e7();
+    scheme = "3F";   test_3f();
+    scheme = "UA";   test_ua();
+    scheme = "CV 2K"; test_cv(2048);
+    scheme = "CV 4K"; test_cv(4096);
+    scheme = "FE";   test_fe();
+    scheme = "set_type"; test_set_type();
+    scheme = "small"; test_small();
+    scheme = "romdb"; test_romdb();
+
+    emu_shutdown(&emu);
+
+    if (failures) {
+        printf("%d of %d checks failed\n", failures, checks);
+        return 1;
+    }
+    printf("all ok: %d checks\n", checks);
+    return 0;
+}
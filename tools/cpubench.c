@@ -0,0 +1,99 @@
+/* CPU core microbenchmark: runs the same ROM on the reference switch core,
+ * the table-driven core and (on GCC) the threaded core, CPU only.
+ *
+ *   cpubench <rom> [instructions]
+ *
+ * WSYNC/JAM halts are released immediately so the CPU never idles; TIA and
+ * RIOT are not ticked (TIA accesses find the beam ahead of the CPU, so
+ * emu_sync() does nothing), so this measures instruction dispatch and
+ * decode only, not a real frame.
+ */
+#include "emulator.h"
+#include "cartridge.h"
+#include "cpu6507.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static EmulatorState base;
+static EmulatorState emu;
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Keeps emu_sync() from running the TIA until the next call: far more
+ * than any step or cpu_run() slice takes */
+static void hold_tia(void)
+{
+    emu.cpu.halted = 0;
+    emu.sync_cycles = emu.cpu.cycles + (1u << 30);
+}
+
+static void run_switch(uint64_t count)
+{
+    while (emu.cpu.instructions < count) {
+        hold_tia();
+        cpu_step_switch(&emu);
+    }
+}
+
+static void run_table(uint64_t count)
+{
+    while (emu.cpu.instructions < count) {
+        hold_tia();
+        cpu_step(&emu);
+    }
+}
+
+static void run_threaded(uint64_t count)
+{
+    while (emu.cpu.instructions < count) {
+        hold_tia();
+        cpu_run(&emu, 76);
+    }
+}
+
+static double bench(const char* name, void (*run)(uint64_t), uint64_t count,
+                    double ref)
+{
+    emu = base;
+    mem_map_init(&emu);
+
+    double t0 = now_sec();
+    run(count);
+    double dt = now_sec() - t0;
+
+    double ips = emu.cpu.instructions / dt;
+    printf("%-9s %12llu instr %8.3f s %10.2f Minstr/s", name,
+           (unsigned long long)emu.cpu.instructions, dt, ips / 1e6);
+    if (ref > 0) printf("  x%.2f", ips / ref);
+    printf("\n");
+    return ips;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <rom> [instructions]\n", argv[0]);
+        return 1;
+    }
+    uint64_t count = argc > 2 ? strtoull(argv[2], NULL, 0) : 50000000ULL;
+
+    emu_init(&base);
+    if (!cart_load(&base, argv[1])) {
+        fprintf(stderr, "cannot load %s\n", argv[1]);
+        return 1;
+    }
+    emu_reset(&base);
+
+    double ref = bench("switch", run_switch, count, 0);
+    bench("table", run_table, count, ref);
+    bench("threaded", run_threaded, count, ref);
+
+    emu_shutdown(&base);
+    return 0;
+}
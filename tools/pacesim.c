@@ -0,0 +1,153 @@
+/* Frame pacing simulation: drives the pacer and the audio output stage
+ * with virtual clocks, no emulator and no waiting, and reports how well
+ * emulation and sound stay locked.
+ *
+ *   pacesim [--hz 59.94] [--display 60] [--jitter ms] [--stall p]
+ *           [--skew ppm] [--rate hz] [--buffer n] [--seconds s]
+ *           [--seed n] [--no-drc]
+ *
+ * The display flips at --display Hz; each vsync is seen up to --jitter ms
+ * late, and with probability --stall the loop misses it altogether. The
+ * audio device pulls 512-sample periods at --rate Hz off by --skew ppm,
+ * as a real sound card's crystal is. Every emulated frame gives the TIA
+ * samples of one frame at --hz. Reports the measured display rate and
+ * jitter, frames repeated and dropped, emulation drift, the fill of the
+ * audio queue and its underruns and overruns, with or without dynamic
+ * rate control.
+ */
+#include "audio.h"
+#include "pacer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PERIOD 512
+
+static uint32_t rng_state = 1;
+
+/* Uniform in [0, 1) */
+static double rng(void)
+{
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return (rng_state >> 8) / 16777216.0;
+}
+
+static void usage(const char* prog)
+{
+    fprintf(stderr, "usage: %s [--hz 59.94] [--display 60] [--jitter ms] [--stall p]\n"
+                    "       [--skew ppm] [--rate hz] [--buffer n] [--seconds s]\n"
+                    "       [--seed n] [--no-drc]\n", prog);
+}
+
+int main(int argc, char** argv)
+{
+    double hz = PACER_NTSC_HZ, display = 60.0, jitter_ms = 1.0, stall = 0.0;
+    double skew_ppm = 0.0, seconds = 600.0;
+    int rate = 48000, drc = 1;
+    uint32_t buffer = 4096;
+    static AudioOut ao;
+    static int16_t frame[TIA_AUDIO_MAX];
+    int16_t period[PERIOD];
+    Pacer p;
+    int frame_len;
+    uint64_t k = 0, pulls = 0;
+    double pull_dt, start = -1;
+    uint32_t fill_min = UINT32_MAX, fill_max = 0;
+    double fill_sum = 0;
+    uint64_t fill_n = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--hz") && i + 1 < argc) hz = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--display") && i + 1 < argc) display = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--jitter") && i + 1 < argc) jitter_ms = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--stall") && i + 1 < argc) stall = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--skew") && i + 1 < argc) skew_ppm = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--rate") && i + 1 < argc) rate = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--buffer") && i + 1 < argc)
+            buffer = (uint32_t)strtoul(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "--seconds") && i + 1 < argc) seconds = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc)
+            rng_state = (uint32_t)strtoul(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "--no-drc")) drc = 0;
+        else { usage(argv[0]); return 2; }
+    }
+    if (hz <= 0 || display <= 0 || seconds <= 0) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (!audio_out_init(&ao, rate, buffer)) {
+        fprintf(stderr, "bad output rate %d\n", rate);
+        return 1;
+    }
+    pacer_init(&p, hz);
+
+    /* A square wave, so the stream is not silent */
+    frame_len = (int)(TIA_SAMPLE_RATE / hz + 0.5);
+    if (frame_len > TIA_AUDIO_MAX) frame_len = TIA_AUDIO_MAX;
+    for (int i = 0; i < frame_len; i++) frame[i] = (i / 32 & 1) ? 8000 : 0;
+    pull_dt = PERIOD / (rate * (1 + skew_ppm * 1e-6));
+
+    for (;;) {
+        double vsync = k / display;
+        double seen = vsync + rng() * jitter_ms * 1e-3;
+        double next_pull = start + pulls * pull_dt;
+
+        /* The device starts once the queue is filled to the target */
+        if (start >= 0 && next_pull < seen) {
+            uint32_t q = audioring_count(&ao.ring);
+            if (q < fill_min) fill_min = q;
+            if (q > fill_max) fill_max = q;
+            fill_sum += q;
+            fill_n++;
+            audio_out_pull(&ao, period, PERIOD);
+            pulls++;
+            continue;
+        }
+        if (vsync >= seconds) break;
+        k++;
+        if (rng() < stall) continue;
+
+        pacer_vsync(&p, seen);
+        for (int n = pacer_frames(&p); n > 0; n--)
+            audio_out_push(&ao, frame, frame_len);
+        if (drc)
+            audio_out_set_factor(&ao, pacer_drc(&p, audioring_count(&ao.ring),
+                                                audioring_size(&ao.ring)));
+        if (start < 0 && audioring_count(&ao.ring) >= audioring_size(&ao.ring) * p.drc_target)
+            start = seen;
+    }
+
+    {
+        double jit_avg, jit_max, lat_min, lat_avg, lat_max;
+        double emulated = p.frames / hz;
+        double per = 1000.0 / rate;
+
+        pacer_jitter(&p, &jit_avg, &jit_max);
+        audio_out_latency(&ao, &lat_min, &lat_avg, &lat_max);
+
+        printf("setup        %.2f Hz game on %.2f Hz display, jitter %.1f ms, stall %.3f, "
+               "audio %d Hz %+.0f ppm, %u-sample queue, rate control %s\n",
+               hz, display, jitter_ms, stall, rate, skew_ppm, audioring_size(&ao.ring),
+               drc ? "on" : "off");
+        printf("display      %.3f Hz measured, %s, jitter %.2f ms avg, %.2f ms max, "
+               "%u vsyncs missed\n", pacer_display_hz(&p),
+               p.locked ? "locked 1:1" : "scheduled", jit_avg, jit_max, p.missed);
+        printf("frames       %u in %.0f s: %u repeated, %u dropped\n",
+               p.frames, seconds, p.repeated, p.dropped);
+        printf("drift        emulation %+.1f ms (%+.0f ppm)\n",
+               (emulated - seconds) * 1000.0, (emulated / seconds - 1) * 1e6);
+        printf("queue        %.1f%% min, %.1f%% avg, %.1f%% max (%.1f / %.1f / %.1f ms)\n",
+               fill_n ? fill_min * 100.0 / audioring_size(&ao.ring) : 0.0,
+               fill_n ? fill_sum * 100.0 / fill_n / audioring_size(&ao.ring) : 0.0,
+               fill_max * 100.0 / audioring_size(&ao.ring),
+               fill_n ? fill_min * per : 0.0, fill_n ? fill_sum / fill_n * per : 0.0,
+               fill_max * per);
+        printf("audio        %u underruns (%llu samples), %u overruns (%llu samples), "
+               "latency %.1f ms avg\n", ao.underruns, (unsigned long long)ao.missing,
+               ao.overruns, (unsigned long long)ao.dropped, lat_avg);
+        printf("correction   %.4f .. %.4f\n", p.factor_min, p.factor_max);
+    }
+
+    audio_out_free(&ao);
+    return ao.underruns || ao.overruns ? 1 : 0;
+}
@@ -0,0 +1,333 @@
+/* Regression and performance suite: runs every ROM of a directory for a
+ * fixed number of frames, hashes each frame and compares against golden
+ * hash files.
+ *
+ *   regress <romdir> [--golden dir] [--frames N] [--jobs N]
+ *           [--report file.json] [--update]
+ *
+ * A frame hash covers the RGB framebuffer, RAM and CPU registers. Input
+ * comes from <rom>.input next to the ROM when present (see script.h),
+ * the built-in pattern otherwise. Golden files are <golden>/<rom>.hash,
+ * one hex hash per frame; --update rewrites them. The JSON report lists
+ * status and timing per ROM. Exit status is 1 when any ROM fails.
+ */
+#include "batch.h"
+#include "hash.h"
+#include "romcache.h"
+#include "script.h"
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef enum { ST_PASS, ST_FAIL, ST_NEW, ST_UPDATED, ST_ERROR } Status;
+
+static const char* status_name[] = { "pass", "fail", "new", "updated", "error" };
+
+typedef struct {
+    char     name[256];
+    Status   status;
+    int      first_diff;   /* first mismatching frame, -1 if none */
+    uint64_t final_hash;   /* hash over all frame hashes */
+    double   seconds;
+    uint64_t cycles;
+    uint64_t instructions;
+
+    RomImage*   rom;
+    InputScript script;
+    uint64_t*   hashes;
+} RomResult;
+
+static const char* rom_dir;
+static const char* golden_dir;
+static uint32_t frames = 600;
+static int update;
+
+static RomResult* results;
+static int rom_count;
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int is_rom(const char* name)
+{
+    const char* ext = strrchr(name, '.');
+    return ext && (!strcmp(ext, ".bin") || !strcmp(ext, ".a26") || !strcmp(ext, ".rom"));
+}
+
+static int cmp_result(const void* a, const void* b)
+{
+    return strcmp(((const RomResult*)a)->name, ((const RomResult*)b)->name);
+}
+
+static int scan_roms(void)
+{
+    DIR* d = opendir(rom_dir);
+    struct dirent* de;
+    int cap = 0;
+
+    if (!d) return 0;
+    while ((de = readdir(d)) != NULL) {
+        if (!is_rom(de->d_name) || strlen(de->d_name) >= sizeof(results->name))
+            continue;
+        if (rom_count == cap) {
+            RomResult* grown;
+
+            cap = cap ? cap * 2 : 32;
+            grown = realloc(results, cap * sizeof(RomResult));
+            if (!grown) {
+                closedir(d);
+                return 0;
+            }
+            results = grown;
+        }
+        memset(&results[rom_count], 0, sizeof(RomResult));
+        strcpy(results[rom_count].name, de->d_name);
+        rom_count++;
+    }
+    closedir(d);
+    qsort(results, rom_count, sizeof(RomResult), cmp_result);
+    return 1;
+}
+
+/* Golden hashes, or NULL when the file does not exist; *err is set
+ * when it exists but cannot be loaded */
+static uint64_t* load_golden(const char* path, int* err)
+{
+    FILE* f = fopen(path, "r");
+    uint64_t* h;
+    uint32_t i;
+
+    *err = 0;
+    if (!f) return NULL;
+    h = malloc(frames * sizeof(uint64_t));
+    if (!h) {
+        fclose(f);
+        *err = 1;
+        return NULL;
+    }
+    for (i = 0; i < frames; i++) {
+        unsigned long long v;
+        if (fscanf(f, "%llx", &v) != 1) break;
+        h[i] = v;
+    }
+    fclose(f);
+    /* A shorter file only covers its frames; mark the rest as mismatches */
+    for (; i < frames; i++) h[i] = ~0ULL;
+    return h;
+}
+
+static int save_golden(const char* path, const uint64_t* h)
+{
+    FILE* f = fopen(path, "w");
+    uint32_t i;
+
+    if (!f) return 0;
+    for (i = 0; i < frames; i++)
+        fprintf(f, "%016llx\n", (unsigned long long)h[i]);
+    return fclose(f) == 0;
+}
+
+/* ROM image and input script of a ROM, status ST_ERROR on failure */
+static void prepare_rom(RomResult* r)
+{
+    char path[1024];
+
+    r->first_diff = -1;
+    snprintf(path, sizeof(path), "%s/%s.input", rom_dir, r->name);
+    if (access(path, R_OK) == 0) {
+        if (!script_load(&r->script, path)) {
+            r->status = ST_ERROR;
+            return;
+        }
+    } else {
+        script_default(&r->script, frames);
+    }
+
+    snprintf(path, sizeof(path), "%s/%s", rom_dir, r->name);
+    r->rom = romcache_open(path);
+    r->hashes = malloc(frames * sizeof(uint64_t));
+    if (!r->rom || !r->hashes) r->status = ST_ERROR;
+}
+
+static void check_rom(RomResult* r, const BatchJob* job)
+{
+    char golden_path[1024];
+    uint64_t* golden;
+    int err;
+
+    if (!job->ok) {
+        r->status = ST_ERROR;
+        return;
+    }
+    r->seconds = job->seconds;
+    r->cycles = job->cycles;
+    r->instructions = job->instructions;
+    r->final_hash = job->run_hash;
+
+    snprintf(golden_path, sizeof(golden_path), "%s/%s.hash", golden_dir, r->name);
+    golden = load_golden(golden_path, &err);
+    if (err) {
+        r->status = ST_ERROR;
+        return;
+    }
+    if (golden) {
+        for (uint32_t f = 0; f < frames; f++) {
+            if (golden[f] != r->hashes[f]) {
+                r->first_diff = (int)f;
+                break;
+            }
+        }
+        free(golden);
+        r->status = r->first_diff < 0 ? ST_PASS : ST_FAIL;
+    } else {
+        r->status = ST_NEW;
+    }
+
+    if (update && r->status != ST_PASS)
+        r->status = save_golden(golden_path, r->hashes) ? ST_UPDATED : ST_ERROR;
+}
+
+/* s as a JSON string: quotes, backslashes and control characters
+ * escaped, other bytes (UTF-8 file names) as they are */
+static void json_string(FILE* f, const char* s)
+{
+    fputc('"', f);
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') fprintf(f, "\\%c", c);
+        else if (c < 0x20)          fprintf(f, "\\u%04x", c);
+        else                        fputc(c, f);
+    }
+    fputc('"', f);
+}
+
+static void write_report(FILE* f, int jobs, double wall, const int* counts)
+{
+    fprintf(f, "{\n  \"frames\": %u,\n  \"jobs\": %d,\n  \"wall_seconds\": %.3f,\n",
+            frames, jobs, wall);
+    fprintf(f, "  \"passed\": %d,\n  \"failed\": %d,\n  \"new\": %d,\n"
+               "  \"updated\": %d,\n  \"errors\": %d,\n  \"roms\": [\n",
+            counts[ST_PASS], counts[ST_FAIL], counts[ST_NEW],
+            counts[ST_UPDATED], counts[ST_ERROR]);
+    for (int i = 0; i < rom_count; i++) {
+        const RomResult* r = &results[i];
+        double s = r->seconds > 0 ? r->seconds : 1e-9;
+        fprintf(f, "    { \"rom\": ");
+        json_string(f, r->name);
+        fprintf(f, ", \"status\": \"%s\", \"first_diff\": %d, "
+                   "\"hash\": \"%016llx\", \"seconds\": %.4f, \"fps\": %.1f, "
+                   "\"mcycles_per_sec\": %.2f, \"ns_per_instr\": %.2f }%s\n",
+                status_name[r->status], r->first_diff,
+                (unsigned long long)r->final_hash, r->seconds, frames / s,
+                r->cycles / s / 1e6,
+                r->instructions ? r->seconds * 1e9 / r->instructions : 0.0,
+                i + 1 < rom_count ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+}
+
+static void usage(const char* prog)
+{
+    fprintf(stderr, "usage: %s <romdir> [--golden dir] [--frames N] [--jobs N] "
+                    "[--report file.json] [--update]\n", prog);
+}
+
+int main(int argc, char** argv)
+{
+    const char* report = NULL;
+    int jobs = batch_cpu_count();
+    int counts[5] = { 0 };
+    BatchJob* batch;
+    int* batch_rom;
+    int batch_count = 0;
+    double t0, wall;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--golden") && i + 1 < argc) golden_dir = argv[++i];
+        else if (!strcmp(argv[i], "--frames") && i + 1 < argc) frames = (uint32_t)strtoul(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "--jobs") && i + 1 < argc) jobs = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--report") && i + 1 < argc) report = argv[++i];
+        else if (!strcmp(argv[i], "--update")) update = 1;
+        else if (argv[i][0] == '-' || rom_dir) { usage(argv[0]); return 2; }
+        else rom_dir = argv[i];
+    }
+    if (!rom_dir || !frames) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (!golden_dir) golden_dir = rom_dir;
+    if (jobs < 1) jobs = 1;
+
+    if (!scan_roms()) {
+        fprintf(stderr, "cannot read %s\n", rom_dir);
+        return 2;
+    }
+    if (update) mkdir(golden_dir, 0777);
+    if (jobs > rom_count) jobs = rom_count ? rom_count : 1;
+
+    batch = calloc(rom_count ? rom_count : 1, sizeof(BatchJob));
+    batch_rom = calloc(rom_count ? rom_count : 1, sizeof(int));
+    if (!batch || !batch_rom) {
+        fprintf(stderr, "out of memory\n");
+        return 2;
+    }
+    for (int i = 0; i < rom_count; i++) {
+        RomResult* r = &results[i];
+        BatchJob* job = &batch[batch_count];
+
+        prepare_rom(r);
+        if (r->status == ST_ERROR) continue;
+        job->rom = r->rom;
+        job->script = &r->script;
+        job->frames = frames;
+        job->frame_hashes = r->hashes;
+        batch_rom[batch_count++] = i;
+    }
+
+    t0 = now_sec();
+    batch_run(batch, batch_count, jobs);
+    wall = now_sec() - t0;
+
+    for (int j = 0; j < batch_count; j++)
+        check_rom(&results[batch_rom[j]], &batch[j]);
+
+    for (int i = 0; i < rom_count; i++) {
+        const RomResult* r = &results[i];
+        counts[r->status]++;
+        fprintf(stderr, "%-8s %-40s %8.1f fps", status_name[r->status], r->name,
+                r->seconds > 0 ? frames / r->seconds : 0.0);
+        if (r->status == ST_FAIL) fprintf(stderr, "  first diff at frame %d", r->first_diff);
+        fprintf(stderr, "\n");
+    }
+    fprintf(stderr, "%d ROMs, %d passed, %d failed, %d new, %d updated, %d errors, %.2f s\n",
+            rom_count, counts[ST_PASS], counts[ST_FAIL], counts[ST_NEW],
+            counts[ST_UPDATED], counts[ST_ERROR], wall);
+
+    if (report) {
+        FILE* f = strcmp(report, "-") ? fopen(report, "w") : stdout;
+        if (!f) {
+            fprintf(stderr, "cannot write %s\n", report);
+            return 2;
+        }
+        write_report(f, jobs, wall, counts);
+        if (f != stdout) fclose(f);
+    }
+
+    for (int i = 0; i < rom_count; i++) {
+        romcache_release(results[i].rom);
+        free(results[i].hashes);
+        script_free(&results[i].script);
+    }
+    free(batch);
+    free(batch_rom);
+    free(results);
+    return counts[ST_FAIL] || counts[ST_ERROR] ? 1 : 0;
+}
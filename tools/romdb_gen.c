@@ -0,0 +1,210 @@
+/* ROM database generator: hashes a list of ROM files and writes the
+ * sorted table compiled into src/romdb.c.
+ *
+ *   romdb_gen <list> [-o src/romdb_table.h]
+ *
+ * One ROM per line of the list, '#' starts a comment that names the
+ * entry in the table (the file name if there is none):
+ *
+ *   <path> [type] [sc] [pal]
+ *   <md5> <size> <type> [sc] [pal]
+ *
+ * type is 2K 4K F8 F6 F4 FE E0 3F E7 FA CV UA, or auto (the default) to
+ * take what cart_detect() guesses. The second form takes a digest from
+ * another database (tools/romdb.txt lists Stella's for games the
+ * guesses get wrong) and needs the type. Paths must not contain spaces.
+ * A ROM listed twice keeps its first line.
+ */
+#include "romdb.h"
+#include "romfile.h"
+#include "cartridge.h"
+#include "hash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    RomDbEntry e;
+    int  order;         /* line order, so the first of two copies wins */
+    char name[64];
+} Row;
+
+static const char* type_names[] = {
+    "2K", "4K", "F8", "F6", "F4", "FE", "E0", "3F", "E7", "FA", "CV", "UA"
+};
+static const char* type_enums[] = {
+    "CART_2K", "CART_4K", "CART_F8", "CART_F6", "CART_F4", "CART_FE",
+    "CART_E0", "CART_3F", "CART_E7", "CART_FA", "CART_CV", "CART_UA"
+};
+
+static int cmp_row(const void* a, const void* b)
+{
+    const Row* x = (const Row*)a;
+    const Row* y = (const Row*)b;
+
+    int c = memcmp(x->e.md5, y->e.md5, MD5_SIZE);
+
+    return c ? c : x->order - y->order;
+}
+
+/* 32 hex digits into an MD5 digest, 0 if it is not one */
+static int parse_md5(const char* s, uint8_t digest[MD5_SIZE])
+{
+    if (strlen(s) != MD5_SIZE * 2 || strspn(s, "0123456789abcdefABCDEF") != MD5_SIZE * 2)
+        return 0;
+    for (int i = 0; i < MD5_SIZE; i++) {
+        unsigned v;
+        sscanf(s + i * 2, "%2x", &v);
+        digest[i] = (uint8_t)v;
+    }
+    return 1;
+}
+
+/* Parse one list line into r, 0 on error (message printed) */
+static int parse_line(char* line, const char* title, int lineno, Row* r)
+{
+    char* path = strtok(line, " \t\r\n");
+    char* tok;
+    int type = -1, digest;
+    RomFile f;
+    const char* base;
+
+    memset(r, 0, sizeof(Row));
+    digest = parse_md5(path, r->e.md5);
+    if (digest) {
+        char* end;
+        tok = strtok(NULL, " \t\r\n");
+        r->e.size = tok ? (uint32_t)strtoul(tok, &end, 10) : 0;
+        if (!tok || *end || r->e.size == 0 || r->e.size > CART_MAX_ROM_SIZE) {
+            fprintf(stderr, "line %d: size missing after the digest\n", lineno);
+            return 0;
+        }
+    }
+    while ((tok = strtok(NULL, " \t\r\n")) != NULL) {
+        int i;
+        if (!strcmp(tok, "sc"))           r->e.superchip = 1;
+        else if (!strcmp(tok, "pal"))     r->e.tv = TV_PAL;
+        else if (!strcmp(tok, "ntsc"))    r->e.tv = TV_NTSC;
+        else if (!strcmp(tok, "auto"))    type = -1;
+        else {
+            for (i = 0; i < 12 && strcmp(tok, type_names[i]); i++) ;
+            if (i == 12) {
+                fprintf(stderr, "line %d: unknown word '%s'\n", lineno, tok);
+                return 0;
+            }
+            type = i;
+        }
+    }
+
+    if (digest) {
+        if (type < 0) {
+            fprintf(stderr, "line %d: a digest needs the type\n", lineno);
+            return 0;
+        }
+    } else {
+        if (!romfile_open(&f, path, CART_MAX_ROM_SIZE)) {
+            fprintf(stderr, "line %d: cannot read %s\n", lineno, path);
+            return 0;
+        }
+        md5(f.data, f.size, r->e.md5);
+        r->e.size = f.size;
+        if (type < 0) {
+            int sc;
+            type = cart_detect(f.data, f.size, &sc);
+            r->e.superchip |= sc;
+        }
+        romfile_close(&f);
+    }
+    r->e.type = (uint8_t)type;
+
+    base = strrchr(path, '/');
+    base = base ? base + 1 : path;
+    snprintf(r->name, sizeof(r->name), "%s", title ? title : base);
+    /* Keep the comment closed */
+    for (char* p = r->name; *p; p++)
+        if (*p == '*' || *p == '/') *p = '_';
+    return 1;
+}
+
+static void usage(const char* prog)
+{
+    fprintf(stderr, "usage: %s <list> [-o src/romdb_table.h]\n", prog);
+}
+
+int main(int argc, char** argv)
+{
+    const char* list_path = NULL;
+    const char* out_path = NULL;
+    FILE* list;
+    FILE* out;
+    Row* rows = NULL;
+    int count = 0, cap = 0, lineno = 0, errors = 0, kept = 0;
+    char line[1024];
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-o") && i + 1 < argc) out_path = argv[++i];
+        else if (argv[i][0] == '-' || list_path) { usage(argv[0]); return 2; }
+        else list_path = argv[i];
+    }
+    if (!list_path) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    list = fopen(list_path, "r");
+    if (!list) {
+        fprintf(stderr, "cannot read %s\n", list_path);
+        return 2;
+    }
+    while (fgets(line, sizeof(line), list)) {
+        char* hash_mark = strchr(line, '#');
+        char* title = NULL;
+        lineno++;
+        if (hash_mark) {
+            *hash_mark = '\0';
+            title = hash_mark + 1 + strspn(hash_mark + 1, " \t");
+            title[strcspn(title, "\r\n")] = '\0';
+            if (!*title) title = NULL;
+        }
+        if (strspn(line, " \t\r\n") == strlen(line)) continue;
+
+        if (count == cap) {
+            cap = cap ? cap * 2 : 256;
+            rows = realloc(rows, cap * sizeof(Row));
+        }
+        if (parse_line(line, title, lineno, &rows[count])) {
+            rows[count].order = count;
+            count++;
+        } else {
+            errors++;
+        }
+    }
+    fclose(list);
+
+    qsort(rows, count, sizeof(Row), cmp_row);
+
+    out = out_path ? fopen(out_path, "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "cannot write %s\n", out_path);
+        return 2;
+    }
+    fprintf(out, "/* Generated by tools/romdb_gen - do not edit.\n"
+                 " * { md5, size, CartType, superchip, TvFormat } */\n");
+    for (int i = 0; i < count; i++) {
+        const RomDbEntry* e = &rows[i].e;
+        if (i && !memcmp(e->md5, rows[i - 1].e.md5, MD5_SIZE)) {
+            fprintf(stderr, "%s: same ROM as %s, skipped\n", rows[i].name, rows[i - 1].name);
+            continue;
+        }
+        fprintf(out, "    /* %s */\n    { {", rows[i].name);
+        for (int k = 0; k < MD5_SIZE; k++)
+            fprintf(out, "%s0x%02x", k ? "," : " ", e->md5[k]);
+        fprintf(out, " },\n      %6u, %s, %d, %s },\n", e->size, type_enums[e->type],
+                e->superchip, e->tv == TV_PAL ? "TV_PAL" : "TV_NTSC");
+        kept++;
+    }
+    if (out != stdout) fclose(out);
+
+    fprintf(stderr, "%d ROMs, %d errors\n", kept, errors);
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,161 @@
+#include "script.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int add_event(InputScript* s, uint32_t frame, uint16_t buttons)
+{
+    if (s->count == s->cap) {
+        int cap = s->cap ? s->cap * 2 : 64;
+        ScriptEvent* ev = realloc(s->events, cap * sizeof(ScriptEvent));
+        if (!ev) return 0;
+        s->events = ev;
+        s->cap = cap;
+    }
+    s->events[s->count].frame = frame;
+    s->events[s->count].buttons = buttons;
+    s->count++;
+    return 1;
+}
+
+static int parse_button(const char* tok, uint16_t* buttons)
+{
+    static const char names[] = "UDLRF";
+    const char* p;
+
+    if (!strcmp(tok, "-"))      return 1;
+    if (!strcmp(tok, "RESET"))  { *buttons |= BTN_RESET; return 1; }
+    if (!strcmp(tok, "SELECT")) { *buttons |= BTN_SELECT; return 1; }
+    if (tok[0] && !tok[1]) {
+        if ((p = strchr(names, tok[0])) != NULL) {
+            *buttons |= 1 << (p - names);
+            return 1;
+        }
+        if (tok[0] >= 'a' && (p = strchr(names, tok[0] - 'a' + 'A')) != NULL) {
+            *buttons |= BTN_P1(1 << (p - names));
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int script_load(InputScript* s, const char* path)
+{
+    char line[256];
+    int lineno = 0;
+    FILE* f = fopen(path, "r");
+
+    memset(s, 0, sizeof(*s));
+    if (!f) {
+        fprintf(stderr, "%s: cannot open\n", path);
+        return 0;
+    }
+
+    while (fgets(line, sizeof(line), f)) {
+        char* hash = strchr(line, '#');
+        char* tok;
+        uint16_t buttons = 0;
+        uint32_t frame;
+
+        lineno++;
+        if (hash) *hash = '\0';
+        tok = strtok(line, " \t\r\n");
+        if (!tok) continue;
+
+        frame = (uint32_t)strtoul(tok, NULL, 10);
+        while ((tok = strtok(NULL, " \t\r\n")) != NULL) {
+            if (!parse_button(tok, &buttons)) {
+                fprintf(stderr, "%s:%d: unknown button '%s'\n", path, lineno, tok);
+                fclose(f);
+                script_free(s);
+                return 0;
+            }
+        }
+        if (s->count && frame < s->events[s->count - 1].frame) {
+            fprintf(stderr, "%s:%d: frames must not go backwards\n", path, lineno);
+            fclose(f);
+            script_free(s);
+            return 0;
+        }
+        if (!add_event(s, frame, buttons)) {
+            fclose(f);
+            script_free(s);
+            return 0;
+        }
+    }
+
+    fclose(f);
+    return 1;
+}
+
+/* Built-in script: steer left and right, fire now and then, press
+ * RESET once at the start */
+void script_default(InputScript* s, uint32_t frames)
+{
+    static const uint16_t pattern[8] = {
+        BTN_RESET, 0, BTN_RIGHT, BTN_RIGHT | BTN_FIRE,
+        BTN_UP, BTN_LEFT, BTN_LEFT | BTN_DOWN, BTN_FIRE,
+    };
+    uint32_t f;
+    int i = 0;
+
+    memset(s, 0, sizeof(*s));
+    add_event(s, 0, 0);
+    for (f = 30; f < frames; f += 45, i++)
+        add_event(s, f, pattern[i == 0 ? 0 : 1 + (i - 1) % 7]);
+}
+
+/* Random player 0 input, changing every 4-35 frames: one script per
+ * seed, the same on every host */
+void script_random(InputScript* s, uint32_t frames, uint32_t seed)
+{
+    static const uint16_t dirs[9] = {
+        0, BTN_UP, BTN_DOWN, BTN_LEFT, BTN_RIGHT,
+        BTN_UP | BTN_LEFT, BTN_UP | BTN_RIGHT, BTN_DOWN | BTN_LEFT, BTN_DOWN | BTN_RIGHT,
+    };
+    uint32_t x = seed * 2654435761u + 1;
+    uint32_t f = 0;
+
+    memset(s, 0, sizeof(*s));
+    add_event(s, 0, BTN_RESET);
+    for (f = 4; f < frames; f += 4 + (x >> 27)) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        add_event(s, f, dirs[x % 9] | ((x >> 8) & 1 ? BTN_FIRE : 0));
+    }
+}
+
+void script_rewind(InputScript* s)
+{
+    s->pos = 0;
+    s->buttons = 0;
+}
+
+void script_apply(InputScript* s, EmulatorState* emu, uint32_t frame)
+{
+    uint16_t b;
+
+    while (s->pos < s->count && s->events[s->pos].frame <= frame)
+        s->buttons = s->events[s->pos++].buttons;
+    b = s->buttons;
+
+    emu->joy0_up    = (b & BTN_UP) != 0;
+    emu->joy0_down  = (b & BTN_DOWN) != 0;
+    emu->joy0_left  = (b & BTN_LEFT) != 0;
+    emu->joy0_right = (b & BTN_RIGHT) != 0;
+    emu->joy0_fire  = (b & BTN_FIRE) != 0;
+    emu->joy1_up    = (b & BTN_P1(BTN_UP)) != 0;
+    emu->joy1_down  = (b & BTN_P1(BTN_DOWN)) != 0;
+    emu->joy1_left  = (b & BTN_P1(BTN_LEFT)) != 0;
+    emu->joy1_right = (b & BTN_P1(BTN_RIGHT)) != 0;
+    emu->joy1_fire  = (b & BTN_P1(BTN_FIRE)) != 0;
+    emu->switch_reset  = (b & BTN_RESET) != 0;
+    emu->switch_select = (b & BTN_SELECT) != 0;
+}
+
+void script_free(InputScript* s)
+{
+    free(s->events);
+    memset(s, 0, sizeof(*s));
+}
@@ -0,0 +1,40 @@
+#ifndef SCRIPT_H
+#define SCRIPT_H
+
+#include "types.h"
+
+/* Scripted input for the host tools. A script is a list of
+ * "<frame> <buttons...>" lines; the buttons hold from that frame until
+ * the next line. Buttons: U D L R F (player 0), u d l r f (player 1),
+ * RESET, SELECT, or - for none. '#' starts a comment. */
+
+#define BTN_UP      0x0001
+#define BTN_DOWN    0x0002
+#define BTN_LEFT    0x0004
+#define BTN_RIGHT   0x0008
+#define BTN_FIRE    0x0010
+#define BTN_P1(b)   ((b) << 5)
+#define BTN_RESET   0x0400
+#define BTN_SELECT  0x0800
+
+typedef struct {
+    uint32_t frame;
+    uint16_t buttons;
+} ScriptEvent;
+
+typedef struct {
+    ScriptEvent* events;
+    int count;
+    int cap;
+    int pos;
+    uint16_t buttons;
+} InputScript;
+
+int  script_load(InputScript* s, const char* path);
+void script_default(InputScript* s, uint32_t frames);
+void script_random(InputScript* s, uint32_t frames, uint32_t seed);
+void script_rewind(InputScript* s);
+void script_apply(InputScript* s, EmulatorState* emu, uint32_t frame);
+void script_free(InputScript* s);
+
+#endif
@@ -0,0 +1,97 @@
+/* TIA object mask test: checks the table-driven masks of the span
+ * renderer against the per-pixel reference functions of the pixel
+ * renderer, bit for bit.
+ *
+ *   tiatest
+ *
+ * Players: every GRP value, NUSIZ copy/size mode, REFP and position.
+ * Missiles: every enable, size and position; the ball likewise through
+ * CTRLPF. The static functions are reached by compiling tia.c into this
+ * file. Exits with 1 if any pixel differs.
+ */
+#include "tia.c"
+#include <stdio.h>
+
+#define MAX_REPORTS 10
+
+static int failures;
+
+static void report(const char* what, int a, int b, int c, int pos, int x, int want)
+{
+    if (failures++ < MAX_REPORTS)
+        printf("FAIL %s %02X %02X %02X pos %d pixel %d: mask %d, reference %d\n",
+               what, a, b, c, pos, x, !want, want);
+}
+
+static void test_players(void)
+{
+    LineMask m;
+
+    for (int grp = 0; grp < 256; grp++)
+        for (int mode = 0; mode < 8; mode++)
+            for (int ref = 0; ref < 2; ref++)
+                for (int pos = 0; pos < 160; pos++) {
+                    build_player_mask(&m, (uint8_t)grp, (uint8_t)(ref << 3), pos, (uint8_t)mode);
+                    for (int x = 0; x < 160; x++) {
+                        int want = player_pixel((uint8_t)grp, (uint8_t)(ref << 3), pos,
+                                                (uint8_t)mode, x);
+                        if (mask_get(&m, x) != want)
+                            report("player grp/nusiz/refp", grp, mode, ref << 3, pos, x, want);
+                    }
+                }
+}
+
+static void test_missiles(void)
+{
+    LineMask m;
+
+    for (int en = 0; en < 4; en++)
+        for (int size = 0; size < 4; size++)
+            for (int pos = 0; pos < 160; pos++) {
+                uint8_t nusiz = (uint8_t)(size << 4);
+
+                build_size_mask(&m, (uint8_t)en, pos, nusiz);
+                for (int x = 0; x < 160; x++) {
+                    int want = missile_pixel(x, pos, (uint8_t)en, nusiz);
+                    if (mask_get(&m, x) != want)
+                        report("missile en/nusiz", en, nusiz, 0, pos, x, want);
+                }
+            }
+}
+
+static void test_ball(void)
+{
+    static TIA tia;
+    LineMask m;
+
+    for (int en = 0; en < 4; en++)
+        for (int size = 0; size < 4; size++)
+            for (int pos = 0; pos < 160; pos++) {
+                memset(&tia, 0, sizeof(tia));
+                tia.enabl = (uint8_t)en;
+                tia.ctrlpf = (uint8_t)(size << 4);
+                tia.posbl = pos;
+
+                build_size_mask(&m, tia.enabl, pos, tia.ctrlpf);
+                for (int x = 0; x < 160; x++) {
+                    int want = ball_pixel(&tia, x);
+                    if (mask_get(&m, x) != want)
+                        report("ball enabl/ctrlpf", en, tia.ctrlpf, 0, pos, x, want);
+                }
+            }
+}
+
+int main(void)
+{
+    test_players();
+    test_missiles();
+    test_ball();
+
+    if (failures) {
+        printf("%d pixels differ\n", failures);
+        return 1;
+    }
+    printf("all ok: %d player, %d missile and %d ball cases\n",
+           256 * 8 * 2 * 160, 4 * 4 * 160, 4 * 4 * 160);
+    return 0;
+}